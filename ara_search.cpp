@@ -0,0 +1,262 @@
+#include "ara_search.h"
+#include "reachability.h"
+#include <algorithm>
+#include <stdexcept>
+#include <climits>
+
+ARAStarSearcher::ARAStarSearcher()
+    : reuse_arena_( false), heuristic_( 0), initial_weight_( 1), weight_step_( 0.5), anytime_( false), time_limit_( 0), use_symmetry_( false),
+      control_( 0), interrupted_( NOT_STOPPED), weight_( 1), iteration_( 0), symmetric_( false), pool_( arena_), opened_set_( arena_), goal_vertex_( NO_NODE), bound_( 0) {
+}
+
+void ARAStarSearcher::SetWeight( double weight) {
+    if ( !(weight >= 1) ) {
+        throw std::invalid_argument( "weight");
+    }
+    initial_weight_ = weight;
+    return;
+}
+
+void ARAStarSearcher::SetWeightStep( double step) {
+    if ( !(step > 0) ) {
+        throw std::invalid_argument( "step");
+    }
+    weight_step_ = step;
+    return;
+}
+
+int ARAStarSearcher::Key( int cost, int h) const {
+    // Малая добавка защищает целые произведения от ошибки округления вниз.
+    return cost + int( weight_ * h + 1e-9);
+}
+
+void ARAStarSearcher::Report() {
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    progress_( stats_);
+    return;
+}
+
+void ARAStarSearcher::Expand( NodeIndex vertex) {
+    SideStats& stats = stats_.sides[SearchStats::SOURCE];
+    closed_[vertex] = iteration_;
+    Position position = arena_[vertex].position;
+    Position::MoveList moves;
+    {
+        ProfileScope scope( stats.move_generation_seconds);
+        position.GetPossibleMoves( neighbors_, moves);
+    }
+    stats.generated += moves.Size();
+    int cost = arena_[vertex].cost + 1;
+    Position canonical;
+    for ( int index = 0; index < moves.Size(); ++index ) {
+        const Position::Move& move = moves[index];
+        position.Swap( move.from, move.to);
+        const Position* key = &position;
+        if ( symmetric_ ) {
+            canonical = symmetry_.Canonical( position);
+            key = &canonical;
+        }
+        NodeIndex next;
+        {
+            ProfileScope scope( stats.lookup_seconds);
+            next = pool_.Find( *key);
+        }
+        if ( next == NO_NODE ) {
+            int h;
+            {
+                ProfileScope scope( stats.heuristic_seconds);
+                // Ход переводит в представителя не этим ходом, так что оценка считается заново.
+                h = symmetric_ ? prepared_->Distance( *key) : prepared_->UpdateDistance( position, arena_[vertex].h, move.from, move.to);
+            }
+            ++stats.heuristic_evaluations;
+            next = arena_.Allocate( *key, cost, h, Key( cost, h), vertex);
+            closed_.push_back( -1);
+            pool_.Insert( next);
+            opened_set_.Insert( next);
+            if ( !h && (*key == goal_) ) {
+                goal_vertex_ = next;
+            }
+        } else {
+            ++stats.duplicates;
+            if ( cost < arena_[next].cost ) {
+                ++stats.reopened;
+                arena_[next].parent = vertex;
+                if ( opened_set_.Contains( next) ) {
+                    opened_set_.DecreaseKey( next, cost);
+                } else {
+                    arena_[next].cost = cost;
+                    arena_[next].heuristic = Key( cost, arena_[next].h);
+                    if ( closed_[next] == iteration_ ) {
+                        inconsistent_.push_back( next);
+                    } else {
+                        opened_set_.Insert( next);
+                    }
+                }
+            }
+        }
+        position.Swap( move.from, move.to);
+    }
+    stats.peak_opened = std::max( stats.peak_opened, opened_set_.Size());
+    return;
+}
+
+bool ARAStarSearcher::ImprovePath() {
+    SideStats& stats = stats_.sides[SearchStats::SOURCE];
+    while ( !opened_set_.Empty() ) {
+        if ( stats.expanded >= budget_.NodeLimit() ) {
+            interrupted_ = NODE_LIMIT;
+            return false;
+        }
+        if ( !(stats.expanded % CHECK_PERIOD) ) {
+            if ( progress_ ) {
+                Report();
+            }
+            interrupted_ = budget_.Check( arena_.Capacity() + pool_.Capacity() + closed_.capacity() * sizeof( int));
+            if ( interrupted_ != NOT_STOPPED ) {
+                return false;
+            }
+        }
+        NodeIndex vertex = opened_set_.ExtractMin();
+        if ( (goal_vertex_ != NO_NODE) && (arena_[goal_vertex_].cost <= arena_[vertex].heuristic) ) {
+            opened_set_.Insert( vertex);
+            return true;
+        }
+        ++stats.expanded;
+        Expand( vertex);
+    }
+    return true;
+}
+
+void ARAStarSearcher::Rekey() {
+    std::vector<NodeIndex> vertices;
+    vertices.reserve( opened_set_.Size() + inconsistent_.size());
+    while ( !opened_set_.Empty() ) {
+        vertices.push_back( opened_set_.ExtractMin());
+    }
+    vertices.insert( vertices.end(), inconsistent_.begin(), inconsistent_.end());
+    inconsistent_.clear();
+    for ( size_t index = 0; index < vertices.size(); ++index ) {
+        Vertex& vertex = arena_[vertices[index]];
+        // Несогласованная вершина могла попасть в список несколько раз.
+        if ( !vertex.opened ) {
+            vertex.heuristic = Key( vertex.cost, vertex.h);
+            opened_set_.Insert( vertices[index]);
+        }
+    }
+    return;
+}
+
+double ARAStarSearcher::CurrentBound() const {
+    // Просмотр всей арены; выполняется раз за итерацию, а итераций немного.
+    int lowest = INT_MAX;
+    for ( NodeIndex vertex = 0; vertex < NodeIndex( arena_.Size()); ++vertex ) {
+        if ( arena_[vertex].opened ) {
+            lowest = std::min( lowest, arena_[vertex].cost + arena_[vertex].h);
+        }
+    }
+    for ( size_t index = 0; index < inconsistent_.size(); ++index ) {
+        lowest = std::min( lowest, arena_[inconsistent_[index]].cost + arena_[inconsistent_[index]].h);
+    }
+    int length = arena_[goal_vertex_].cost;
+    if ( (lowest == INT_MAX) || (lowest >= length) ) {
+        return 1;
+    }
+    return double( length) / std::max( lowest, 1);
+}
+
+std::vector<Position> ARAStarSearcher::Search( const Position& source, const Position& goal, long long limit, std::string& error_msg) {
+    error_msg = "";
+    std::vector<Position> way;
+    stats_.Clear();
+    partial_.clear();
+    if ( !CheckReachability( source, goal, error_msg) ) {
+        return way;
+    }
+    start_ = std::chrono::steady_clock::now();
+    budget_.Start( control_, limit, time_limit_);
+    interrupted_ = NOT_STOPPED;
+    weight_ = initial_weight_;
+    iteration_ = 0;
+    goal_vertex_ = NO_NODE;
+    bound_ = 0;
+    goal_ = goal;
+    neighbors_ = NeighborTable( source);
+    symmetric_ = use_symmetry_ && symmetry_.Detect( goal);
+    Position start = symmetric_ ? symmetry_.Canonical( source) : source;
+    prepared_ = PrepareHeuristic( heuristic_, goal);
+    int h = prepared_->Distance( start);
+    stats_.sides[SearchStats::SOURCE].heuristic_evaluations = 1;
+    NodeIndex root = arena_.Allocate( start, 0, h, Key( 0, h), NO_NODE);
+    closed_.push_back( -1);
+    pool_.Insert( root);
+    opened_set_.Insert( root);
+    if ( source == goal ) {
+        goal_vertex_ = root;
+    }
+    int best_length = INT_MAX;
+    while ( true ) {
+        bool finished = ImprovePath();
+        if ( goal_vertex_ != NO_NODE ) {
+            // Отношение к min(g + h) - граница в любой момент, завершенная
+            // итерация дает еще и weight_; длина решения только уменьшается,
+            // поэтому прежняя граница тоже сохраняется.
+            double bound = CurrentBound();
+            if ( finished ) {
+                bound = std::min( bound, weight_);
+            }
+            if ( bound_ > 0 ) {
+                bound = std::min( bound, bound_);
+            }
+            if ( (arena_[goal_vertex_].cost < best_length) || (bound < bound_) ) {
+                best_length = arena_[goal_vertex_].cost;
+                bound_ = bound;
+                way.clear();
+                for ( NodeIndex vertex = goal_vertex_; vertex != NO_NODE; vertex = arena_[vertex].parent ) {
+                    way.push_back( arena_[vertex].position);
+                }
+                std::reverse( way.begin(), way.end());
+                if ( symmetric_ ) {
+                    way = symmetry_.Unfold( source, way);
+                }
+                if ( on_solution_ ) {
+                    on_solution_( way, bound_);
+                }
+            }
+        }
+        if ( !finished || !anytime_ || (goal_vertex_ == NO_NODE) || (bound_ <= 1) ) {
+            break;
+        }
+        weight_ = std::max( 1.0, weight_ - weight_step_);
+        ++iteration_;
+        Rekey();
+    }
+    stats_.sides[SearchStats::SOURCE].closed = pool_.Size() - opened_set_.Size();
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    if ( way.empty() ) {
+        if ( interrupted_ != NOT_STOPPED ) {
+            error_msg = StopMessage( interrupted_);
+            for ( NodeIndex vertex = BestOpened( arena_); vertex != NO_NODE; vertex = arena_[vertex].parent ) {
+                partial_.push_back( arena_[vertex].position);
+            }
+            std::reverse( partial_.begin(), partial_.end());
+            if ( symmetric_ ) {
+                partial_ = symmetry_.Unfold( source, partial_);
+            }
+        } else {
+            error_msg = "No solution";
+        }
+    }
+    opened_set_.Clear();
+    closed_.clear();
+    inconsistent_.clear();
+    if ( reuse_arena_ ) {
+        pool_.Clear();
+        arena_.Clear();
+    } else {
+        opened_set_.Release();
+        pool_.Release();
+        arena_.Release();
+        std::vector<int>().swap( closed_);
+    }
+    return way;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#ifndef _ARA_SEARCH_H_
+#define _ARA_SEARCH_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include "position.h"
+#include "heuristic.h"
+#include "search.h"
+#include "search_stats.h"
+#include "search_control.h"
+#include "symmetry.h"
+
+// Вызывается при каждом улучшении решения: путь и доказанная граница
+// отношения его длины к оптимальной.
+typedef std::function<void( const std::vector<Position>& way, double bound)> SolutionCallback;
+
+// Взвешенный A* и его итеративный вариант ARA*. Очередь упорядочена по
+// g + w*h (целая часть, так что подходит OpenedSet на корзинах), и при
+// допустимой и монотонной оценке решение не длиннее w оптимального.
+// В режиме SetAnytime после каждого решения w уменьшается на шаг до 1, а
+// поиск продолжается с теми же ареной, пулом и очередью: вершины, получившие
+// путь короче уже после раскрытия на текущей итерации, копятся в списке
+// несогласованных и возвращаются в очередь перед следующей итерацией.
+class ARAStarSearcher {
+public:
+    ARAStarSearcher();
+    void SetReuseArena( bool reuse) {reuse_arena_ = reuse;}
+    void SetHeuristic( const Heuristic* heuristic) {heuristic_ = heuristic;}
+    // Вес оценки (начальный в режиме SetAnytime), не меньше 1.
+    void SetWeight( double weight);
+    // Продолжать ли после первого решения, уменьшая вес.
+    void SetAnytime( bool anytime) {anytime_ = anytime;}
+    // Шаг уменьшения веса между итерациями, больше 0.
+    void SetWeightStep( double step);
+    // Хранить по одной позиции на орбиту симметрий цели, если они есть (см.
+    // SymmetryGroup). Оценка должна быть одинаковой для всех позиций орбиты:
+    // манхэттенская, линейные конфликты, walking distance или SymmetricHeuristic.
+    void SetSymmetry( bool symmetry) {use_symmetry_ = symmetry;}
+    // Ограничение времени одного вызова Search в секундах, 0 - без ограничения.
+    void SetTimeLimit( double seconds) {time_limit_ = seconds;}
+    void SetControl( const SearchControl* control) {control_ = control;}
+    void SetSolutionCallback( const SolutionCallback& callback) {on_solution_ = callback;}
+    // Вызывается раз в 1024 раскрытых вершины.
+    void SetProgress( const ProgressCallback& progress) {progress_ = progress;}
+    long long NodesExpanded() const {return stats_.Expanded();}
+    const SearchStats& Stats() const {return stats_;}
+    // Граница отношения длины последнего решения к оптимальной, 0 без решения.
+    double Bound() const {return bound_;}
+    // limit - ограничение на число раскрытых вершин всех итераций. Если
+    // ограничение срабатывает после первого решения, возвращается лучшее
+    // найденное без ошибки; его качество показывает Bound.
+    std::vector<Position> Search( const Position& source, const Position& goal, long long limit, std::string& error_msg);
+    // Путь до вершины очереди с наименьшей оценкой, если поиск прерван до первого решения.
+    const std::vector<Position>& BestPartial() const {return partial_;}
+private:
+    ARAStarSearcher( const ARAStarSearcher&);
+    ARAStarSearcher& operator=( const ARAStarSearcher&);
+    int Key( int cost, int h) const;
+    // Раскрывает вершины, пока стоимость цели больше наименьшего ключа очереди.
+    // false, если поиск остановлен ограничением.
+    bool ImprovePath();
+    void Expand( NodeIndex vertex);
+    // Возвращает несогласованные вершины в очередь и пересчитывает ключи под weight_.
+    void Rekey();
+    // Граница для найденного решения: g(цели) / min(g + h) по очереди и несогласованным.
+    double CurrentBound() const;
+    void Report();
+    bool reuse_arena_;
+    const Heuristic* heuristic_;
+    double initial_weight_;
+    double weight_step_;
+    bool anytime_;
+    double time_limit_;
+    bool use_symmetry_;
+    const SearchControl* control_;
+    SearchBudget budget_;
+    StopReason interrupted_;
+    SolutionCallback on_solution_;
+    ProgressCallback progress_;
+    SearchStats stats_;
+    std::chrono::steady_clock::time_point start_;
+    // Вес текущей итерации и ее номер.
+    double weight_;
+    int iteration_;
+    std::unique_ptr<Heuristic> prepared_;
+    Position goal_;
+    NeighborTable neighbors_;
+    // Симметрии цели; symmetric_ - хранятся ли в арене представители орбит.
+    SymmetryGroup symmetry_;
+    bool symmetric_;
+    VertexArena arena_;
+    VertexPool pool_;
+    OpenedSet opened_set_;
+    // Номер итерации, на которой вершина раскрыта последний раз, -1 - не раскрыта.
+    std::vector<int> closed_;
+    // Вершины, получившие путь короче после раскрытия на текущей итерации (возможны повторы).
+    std::vector<NodeIndex> inconsistent_;
+    NodeIndex goal_vertex_;
+    double bound_;
+    std::vector<Position> partial_;
+};
+
+#endif /* _ARA_SEARCH_H_ */
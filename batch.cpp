@@ -0,0 +1,429 @@
+#include "batch.h"
+#include "search.h"
+#include "ida_search.h"
+#include "hda_search.h"
+#include "parallel_ida_search.h"
+#include "ara_search.h"
+#include "mm_search.h"
+#include "bounded_search.h"
+#include "planner_session.h"
+#include "reachability.h"
+#include "thread_pool.h"
+#include <sstream>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <cstring>
+#include <stdint.h>
+
+const char BINARY_MAGIC[8] = {'1', '5', 'B', 'A', 'T', '\n', 0, 0};
+
+BatchOptions::BatchOptions()
+    : threads( 1), engine( ASTAR), search_threads( 1), weight( 2), heuristic( 0), node_limit( 1000000000LL), time_limit( 0), memory_limit( 0),
+      partial( false), symmetry( false), output_format( SolutionWriter::TEXT), table( 0), cache( 0) {
+}
+
+namespace {
+
+// Максимальное число клеток поля в задаче, защита от мусора на входе.
+const int MAX_CELLS = 1 << 20;
+
+bool CheckCells( int height, int width, const std::vector<int>& cells, std::string& error_msg) {
+    if ( (height <= 0) || (width <= 0) || (height > MAX_CELLS / width) ) {
+        error_msg = "Bad size";
+        return false;
+    }
+    if ( int( cells.size()) != height * width ) {
+        error_msg = "Wrong cell count";
+        return false;
+    }
+    for ( size_t index = 0; index < cells.size(); ++index ) {
+        if ( cells[index] < Position::STONE ) {
+            error_msg = "Bad cell value";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ReadInt( std::istream& input, int32_t& value) {
+    return bool( input.read( reinterpret_cast<char*>( &value), sizeof( value)));
+}
+
+std::string Status( const std::string& error_msg) {
+    if ( error_msg.empty() ) {
+        return "ok";
+    }
+    std::string status = error_msg;
+    for ( size_t index = 0; index < status.size(); ++index ) {
+        if ( status[index] == ' ' ) {
+            status[index] = '_';
+        }
+    }
+    return status;
+}
+
+// Поисковики одного потока пула; используются только этим потоком.
+struct Worker {
+    Worker() {
+        astar.SetReuseArena( true);
+        astar.SetControl( &control);
+        ida.SetControl( &control);
+        hda.SetControl( &control);
+        parallel_ida.SetControl( &control);
+        ara.SetReuseArena( true);
+        ara.SetControl( &control);
+        mm.SetReuseArena( true);
+        mm.SetControl( &control);
+        bounded.SetReuseArena( true);
+        bounded.SetControl( &control);
+    }
+    SearchControl control;
+    AStarSearcher astar;
+    IDAStarSearcher ida;
+    HDAStarSearcher hda;
+    ParallelIDAStarSearcher parallel_ida;
+    ARAStarSearcher ara;
+    MMSearcher mm;
+    MemoryBoundedSearcher bounded;
+};
+
+} // namespace
+
+Position DefaultGoal( const Position& source) {
+    Position goal( source.Height(), source.Width());
+    int cells = source.Height() * source.Width();
+    int tiles = 0;
+    for ( int index = 0; index < cells; ++index ) {
+        if ( source.GetField( index) > Position::BLANK ) {
+            ++tiles;
+        }
+    }
+    int next = 1;
+    for ( int index = 0; index < cells; ++index ) {
+        if ( source.GetField( index) == Position::STONE ) {
+            goal.SetField( index, Position::STONE);
+        } else if ( next <= tiles ) {
+            goal.SetField( index, next++);
+        } else {
+            goal.SetField( index, Position::BLANK);
+        }
+    }
+    return goal;
+}
+
+bool ParseInstance( const std::string& line, Instance& instance, std::string& error_msg) {
+    error_msg = "";
+    std::istringstream stream( line);
+    int height = 0, width = 0;
+    if ( !(stream >> instance.id >> height >> width) ) {
+        error_msg = "Bad header";
+        return false;
+    }
+    std::vector<int> cells, goal;
+    std::vector<int>* target = &cells;
+    std::string token;
+    while ( stream >> token ) {
+        if ( token == "/" ) {
+            if ( target == &goal ) {
+                error_msg = "Extra '/'";
+                return false;
+            }
+            target = &goal;
+            continue;
+        }
+        std::istringstream value_stream( token);
+        int value;
+        if ( !(value_stream >> value) || !value_stream.eof() ) {
+            error_msg = "Bad cell '" + token + "'";
+            return false;
+        }
+        target->push_back( value);
+    }
+    if ( !CheckCells( height, width, cells, error_msg) ) {
+        return false;
+    }
+    instance.source = Position( height, width, cells);
+    if ( target == &goal ) {
+        if ( !CheckCells( height, width, goal, error_msg) ) {
+            return false;
+        }
+        instance.goal = Position( height, width, goal);
+    } else {
+        instance.goal = DefaultGoal( instance.source);
+    }
+    return true;
+}
+
+bool ReadBinaryInstance( std::istream& input, Instance& instance, std::string& error_msg) {
+    error_msg = "";
+    int32_t id_size;
+    if ( !ReadInt( input, id_size) ) {
+        if ( input.gcount() ) {
+            error_msg = "Truncated record";
+        }
+        return false;
+    }
+    int32_t height, width, has_goal;
+    if ( (id_size < 0) || (id_size > 4096) ) {
+        error_msg = "Bad id";
+        return false;
+    }
+    instance.id.assign( size_t( id_size), '\0');
+    if ( (id_size && !input.read( &instance.id[0], id_size)) || !ReadInt( input, height) || !ReadInt( input, width) ) {
+        error_msg = "Truncated record";
+        return false;
+    }
+    if ( (height <= 0) || (width <= 0) || (height > MAX_CELLS / width) ) {
+        error_msg = "Bad size";
+        return false;
+    }
+    std::vector<int> cells;
+    for ( int32_t index = 0, value; index < height * width; ++index ) {
+        if ( !ReadInt( input, value) ) {
+            error_msg = "Truncated record";
+            return false;
+        }
+        cells.push_back( value);
+    }
+    if ( !CheckCells( height, width, cells, error_msg) ) {
+        return false;
+    }
+    instance.source = Position( height, width, cells);
+    if ( !ReadInt( input, has_goal) ) {
+        error_msg = "Truncated record";
+        return false;
+    }
+    if ( !has_goal ) {
+        instance.goal = DefaultGoal( instance.source);
+        return true;
+    }
+    cells.clear();
+    for ( int32_t index = 0, value; index < height * width; ++index ) {
+        if ( !ReadInt( input, value) ) {
+            error_msg = "Truncated record";
+            return false;
+        }
+        cells.push_back( value);
+    }
+    if ( !CheckCells( height, width, cells, error_msg) ) {
+        return false;
+    }
+    instance.goal = Position( height, width, cells);
+    return true;
+}
+
+int SolveBatch( std::istream& input, std::ostream& output, const BatchOptions& options) {
+    // Поиски, оптимальные при допустимой, но не монотонной оценке, получают
+    // оценку, уточненную кэшем.
+    bool optimal = (options.engine == BatchOptions::IDASTAR) || (options.engine == BatchOptions::PARALLEL_IDASTAR)
+        || (options.engine == BatchOptions::MM);
+    const Heuristic* heuristic = options.heuristic;
+    std::unique_ptr<Heuristic> cached;
+    if ( options.cache && optimal ) {
+        ManhattanHeuristic manhattan;
+        cached.reset( new CachedHeuristic( heuristic ? *heuristic : static_cast<const Heuristic&>( manhattan), *options.cache));
+        heuristic = cached.get();
+    }
+    // Кэш пополняется только кратчайшими решениями.
+    optimal = optimal || (options.engine == BatchOptions::HDASTAR) || (options.engine == BatchOptions::BOUNDED_ASTAR);
+    ThreadPool pool( options.threads);
+    std::vector< std::unique_ptr<Worker> > workers;
+    for ( int worker = 0; worker < pool.Size(); ++worker ) {
+        workers.push_back( std::unique_ptr<Worker>( new Worker()));
+        workers.back()->control.SetMemoryBudget( options.memory_limit);
+        workers.back()->astar.SetHeuristic( heuristic);
+        workers.back()->astar.SetTimeLimit( options.time_limit);
+        workers.back()->astar.SetConcurrent( options.engine == BatchOptions::CONCURRENT_ASTAR);
+        workers.back()->ida.SetHeuristic( heuristic);
+        workers.back()->ida.SetTimeLimit( options.time_limit);
+        workers.back()->hda.SetThreads( options.search_threads);
+        workers.back()->hda.SetReuseArena( true);
+        workers.back()->hda.SetHeuristic( heuristic);
+        workers.back()->hda.SetTimeLimit( options.time_limit);
+        workers.back()->parallel_ida.SetThreads( options.search_threads);
+        workers.back()->parallel_ida.SetHeuristic( heuristic);
+        workers.back()->parallel_ida.SetTimeLimit( options.time_limit);
+        workers.back()->ara.SetHeuristic( heuristic);
+        workers.back()->ara.SetTimeLimit( options.time_limit);
+        workers.back()->ara.SetWeight( options.weight);
+        workers.back()->ara.SetAnytime( options.engine == BatchOptions::ARASTAR);
+        workers.back()->ara.SetSymmetry( options.symmetry);
+        workers.back()->mm.SetHeuristic( heuristic);
+        workers.back()->mm.SetTimeLimit( options.time_limit);
+        workers.back()->bounded.SetHeuristic( heuristic);
+        workers.back()->bounded.SetTimeLimit( options.time_limit);
+        workers.back()->bounded.SetSymmetry( options.symmetry);
+    }
+    std::mutex output_mutex;
+    SolutionWriter writer( output, options.output_format);
+    int solved = 0;
+    // Задача решается в потоке worker, результат сразу пишется в output.
+    auto emit = [&]( const Instance& instance, const std::string& error_msg, bool found, const Solution& solution, long long nodes,
+                     std::chrono::steady_clock::time_point start) {
+        long long ms = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock( output_mutex);
+        writer.Write( instance.id, Status( error_msg), found, solution, nodes, ms);
+        writer.Flush();
+        if ( found ) {
+            ++solved;
+        }
+    };
+    auto solve = [&]( const Instance& instance, int worker) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::string error_msg;
+        if ( options.table && options.table->Matches( instance.goal) ) {
+            // Путь по таблице расстояний, без поиска.
+            Solution solution = options.table->Path( instance.source);
+            if ( solution.Empty() && CheckReachability( instance.source, instance.goal, error_msg) ) {
+                error_msg = "No solution";
+            }
+            emit( instance, error_msg, !solution.Empty(), solution, 0, start);
+            return;
+        }
+        if ( options.cache ) {
+            Solution solution = options.cache->Path( instance.source, instance.goal);
+            if ( !solution.Empty() ) {
+                emit( instance, error_msg, true, solution, 0, start);
+                return;
+            }
+        }
+        std::vector<Position> way;
+        const std::vector<Position>* partial;
+        long long nodes;
+        if ( options.engine == BatchOptions::IDASTAR ) {
+            way = workers[worker]->ida.Search( instance.source, instance.goal, options.node_limit, error_msg);
+            nodes = workers[worker]->ida.NodesExpanded();
+            partial = &workers[worker]->ida.BestPartial();
+        } else if ( options.engine == BatchOptions::HDASTAR ) {
+            way = workers[worker]->hda.Search( instance.source, instance.goal, options.node_limit, error_msg);
+            nodes = workers[worker]->hda.NodesExpanded();
+            partial = &workers[worker]->hda.BestPartial();
+        } else if ( options.engine == BatchOptions::PARALLEL_IDASTAR ) {
+            way = workers[worker]->parallel_ida.Search( instance.source, instance.goal, options.node_limit, error_msg);
+            nodes = workers[worker]->parallel_ida.NodesExpanded();
+            partial = &workers[worker]->parallel_ida.BestPartial();
+        } else if ( (options.engine == BatchOptions::WEIGHTED_ASTAR) || (options.engine == BatchOptions::ARASTAR) ) {
+            way = workers[worker]->ara.Search( instance.source, instance.goal, options.node_limit, error_msg);
+            nodes = workers[worker]->ara.NodesExpanded();
+            partial = &workers[worker]->ara.BestPartial();
+        } else if ( options.engine == BatchOptions::MM ) {
+            way = workers[worker]->mm.Search( instance.source, instance.goal, options.node_limit, error_msg);
+            nodes = workers[worker]->mm.NodesExpanded();
+            partial = &workers[worker]->mm.BestPartial();
+        } else if ( options.engine == BatchOptions::BOUNDED_ASTAR ) {
+            way = workers[worker]->bounded.Search( instance.source, instance.goal, options.node_limit, error_msg);
+            nodes = workers[worker]->bounded.NodesExpanded();
+            partial = &workers[worker]->bounded.BestPartial();
+        } else {
+            way = workers[worker]->astar.Search( instance.source, instance.goal, options.node_limit, error_msg);
+            nodes = workers[worker]->astar.NodesExpanded();
+            partial = &workers[worker]->astar.BestPartial();
+        }
+        // Позиции пути заменяются ходами сразу после поиска.
+        bool found = !way.empty();
+        Solution solution = Solution::FromWay( (!found && options.partial) ? *partial : way);
+        std::vector<Position>().swap( way);
+        if ( found && optimal && options.cache ) {
+            options.cache->Store( solution);
+        }
+        emit( instance, error_msg, found, solution, nodes, start);
+    };
+    // Ошибки разбора пишутся сразу из читающего потока.
+    auto report = [&]( const std::string& id, const std::string& error_msg) {
+        std::lock_guard<std::mutex> lock( output_mutex);
+        writer.WriteError( id, Status( error_msg));
+        writer.Flush();
+    };
+
+    // Первые байты потока; если это не BINARY_MAGIC, они - начало первой строки текста.
+    // Вернуть в поток больше одного символа нельзя (stdin), поэтому они сохраняются.
+    char magic[sizeof( BINARY_MAGIC)];
+    input.read( magic, sizeof( magic));
+    std::string prefix( magic, size_t( input.gcount()));
+    bool binary = (prefix.size() == sizeof( magic)) && !memcmp( magic, BINARY_MAGIC, sizeof( magic));
+    if ( !binary ) {
+        input.clear();
+    }
+    std::string error_msg;
+    if ( binary ) {
+        for ( long long record = 1; ; ++record ) {
+            std::shared_ptr<Instance> instance( new Instance());
+            if ( !ReadBinaryInstance( input, *instance, error_msg) ) {
+                if ( !error_msg.empty() ) {
+                    std::ostringstream id;
+                    id << "record:" << record;
+                    report( id.str(), error_msg);
+                }
+                break;
+            }
+            pool.Submit( [instance, &solve]( int worker) {solve( *instance, worker);});
+        }
+    } else {
+        std::string line;
+        for ( long long line_number = 1; ; ++line_number ) {
+            // Первая строка могла целиком уместиться в prefix.
+            size_t end = prefix.find( '\n');
+            if ( end != std::string::npos ) {
+                line = prefix.substr( 0, end);
+                prefix.erase( 0, end + 1);
+            } else if ( std::getline( input, line) ) {
+                line = prefix + line;
+                prefix.clear();
+            } else if ( !prefix.empty() ) {
+                line.swap( prefix);
+                prefix.clear();
+            } else {
+                break;
+            }
+            size_t first = line.find_first_not_of( " \t\r");
+            if ( (first == std::string::npos) || (line[first] == '#') ) {
+                continue;
+            }
+            std::shared_ptr<Instance> instance( new Instance());
+            if ( !ParseInstance( line, *instance, error_msg) ) {
+                std::ostringstream id;
+                id << "line:" << line_number;
+                report( id.str(), error_msg);
+                continue;
+            }
+            pool.Submit( [instance, &solve]( int worker) {solve( *instance, worker);});
+        }
+    }
+    pool.Wait();
+    return solved;
+}
+
+int SolveHints( std::istream& input, std::ostream& output, const BatchOptions& options) {
+    PlannerSession session;
+    session.SetTimeLimit( options.time_limit);
+    if ( options.memory_limit ) {
+        session.SetMemoryLimit( options.memory_limit);
+    }
+    SolutionWriter writer( output, options.output_format);
+    int solved = 0;
+    std::string line, error_msg;
+    for ( long long line_number = 1; std::getline( input, line); ++line_number ) {
+        size_t first = line.find_first_not_of( " \t\r");
+        if ( (first == std::string::npos) || (line[first] == '#') ) {
+            continue;
+        }
+        Instance instance;
+        if ( !ParseInstance( line, instance, error_msg) ) {
+            std::ostringstream id;
+            id << "line:" << line_number;
+            writer.WriteError( id.str(), Status( error_msg));
+            writer.Flush();
+            continue;
+        }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::vector<Position> way = session.Search( instance.source, instance.goal, options.node_limit, error_msg);
+        long long ms = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - start).count();
+        writer.Write( instance.id, Status( error_msg), !way.empty(), Solution::FromWay( way), session.NodesExpanded(), ms);
+        writer.Flush();
+        if ( !way.empty() ) {
+            ++solved;
+        }
+    }
+    return solved;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "position.h"
+#include "heuristic.h"
+#include "solution.h"
+#include "distance_table.h"
+#include "solution_cache.h"
+
+// Задача пакетного решения: пара позиций с идентификатором.
+struct Instance {
+    std::string id;
+    Position source;
+    Position goal;
+};
+
+struct BatchOptions {
+    // WEIGHTED_ASTAR - взвешенный A* с весом weight, ARASTAR - ARA*, начиная
+    // с weight и уточняя решение до time_limit (или node_limit). MM -
+    // двунаправленный поиск с доказательством оптимальности. BOUNDED_ASTAR -
+    // A*, переходящий к IDA* по достижении memory_limit. CONCURRENT_ASTAR -
+    // ASTAR, стороны которого ищут одновременно в двух потоках.
+    enum Engine { ASTAR, IDASTAR, HDASTAR, PARALLEL_IDASTAR, WEIGHTED_ASTAR, ARASTAR, MM, BOUNDED_ASTAR, CONCURRENT_ASTAR };
+    BatchOptions();
+    int threads;
+    Engine engine;
+    // Число потоков одного поиска HDASTAR и PARALLEL_IDASTAR.
+    int search_threads;
+    // Вес оценки для WEIGHTED_ASTAR и ARASTAR, не меньше 1.
+    double weight;
+    // Прототип оценки, 0 - манхэттенская. Должен жить до конца SolveBatch.
+    const Heuristic* heuristic;
+    // Ограничения на одну задачу: число раскрытых вершин и время в секундах (0 - без ограничения).
+    long long node_limit;
+    double time_limit;
+    // Ограничение памяти одного поиска в байтах, 0 - без ограничения.
+    // BOUNDED_ASTAR по нему не прерывается, а продолжает поиск в IDA*.
+    size_t memory_limit;
+    // Выводить ли для прерванного поиска ходы лучшего частичного пути вместо '-'.
+    bool partial;
+    // Хранить по одной позиции на орбиту симметрий цели (WEIGHTED_ASTAR,
+    // ARASTAR, BOUNDED_ASTAR); оценка должна быть одинаковой на орбите.
+    bool symmetry;
+    // Формат вывода результатов, см. SolutionWriter.
+    SolutionWriter::Format output_format;
+    // Таблица расстояний; задачи с ее целью решаются по таблице без поиска,
+    // nodes = 0. Должна жить до конца SolveBatch.
+    const DistanceTable* table;
+    // Кэш решений: задача, путь которой целиком есть в кэше, решается без
+    // поиска (nodes = 0), кратчайшие решения IDASTAR, PARALLEL_IDASTAR,
+    // HDASTAR, MM и BOUNDED_ASTAR добавляются в кэш, а IDASTAR,
+    // PARALLEL_IDASTAR и MM используют CachedHeuristic.
+    SolutionCache* cache;
+};
+
+// Разбирает строку текстового формата:
+//   id height width cell... [/ cell...]
+// Клетки перечисляются по строкам, 0 - пустое место, -1 - камень. Без части
+// после '/' цель - фишки 1, 2, ... по порядку с пустыми местами в конце и
+// камнями на тех же местах. false и error_msg при ошибке формата.
+bool ParseInstance( const std::string& line, Instance& instance, std::string& error_msg);
+
+// Читает одну задачу из двоичного потока:
+//   int32 длина id, байты id, int32 height, int32 width, int32 клетки[height * width],
+//   int32 1 или 0 - задана ли цель, при 1 - int32 клетки цели.
+// Поток начинается с BINARY_MAGIC. false в конце потока или при ошибке (error_msg не пуст).
+bool ReadBinaryInstance( std::istream& input, Instance& instance, std::string& error_msg);
+extern const char BINARY_MAGIC[8];
+
+// Стандартная цель для поля с камнями source.
+Position DefaultGoal( const Position& source);
+
+// Читает задачи из input (текстовый или двоичный формат определяется по
+// первым байтам) и решает их параллельно на пуле потоков, по одному поисковику
+// на поток. Результаты пишутся в output по мере готовности через SolutionWriter
+// в формате options.output_format, в текстовом - строка на задачу:
+//   id status length nodes ms moves
+// status - "ok" или сообщение об ошибке с '_' вместо пробелов, length = -1 без решения.
+// moves - буквы U, R, D, L направления движения пустого места для поля с одним
+// пустым местом, иначе - пары "откуда-куда" номеров клеток сдвигаемой фишки.
+// При options.partial для прерванного поиска moves - ходы лучшего частичного пути.
+// Возвращает число решенных задач.
+int SolveBatch( std::istream& input, std::ostream& output, const BatchOptions& options);
+
+// Решает задачи текстового input по очереди одним PlannerSession: строки -
+// последовательные позиции одной игры (например, после каждого хода игрока),
+// и ответ на каждую переиспользует дерево поиска предыдущих. Результаты в
+// формате SolveBatch выводятся сразу после решения. Из options используются
+// node_limit, time_limit, memory_limit (ограничение дерева сеанса, 0 -
+// PlannerSession::DEFAULT_MEMORY_LIMIT) и output_format; оценка всегда
+// манхэттенская. Возвращает число решенных задач.
+int SolveHints( std::istream& input, std::ostream& output, const BatchOptions& options);
+
+#endif /* _BATCH_H_ */
@@ -0,0 +1,415 @@
+#include "position.h"
+#include "search.h"
+#include "ida_search.h"
+#include "hda_search.h"
+#include "parallel_ida_search.h"
+#include "ara_search.h"
+#include "mm_search.h"
+#include "bounded_search.h"
+#include "symmetry.h"
+#include "heuristic.h"
+#include "pattern_database.h"
+#include "batch.h"
+#include "instances.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Воспроизводимый замер производительности: каждая пара движок/оценка
+// решает фиксированные наборы задач, результаты выводятся в CSV или JSON.
+// Каждый запуск по умолчанию выполняется в отдельном процессе, чтобы пиковая
+// память (getrusage) относилась к одному запуску.
+
+namespace {
+
+struct Options {
+  std::vector<std::string> sets = {"3x3", "3x4", "4x4", "stones",
+                                   "duplicates"};
+  std::vector<std::string> engines = {"astar", "ida"};
+  std::vector<std::string> heuristics = {"manhattan", "linear"};
+  std::string korf_file;
+  std::string instance_file;
+  std::string pdb_file;
+  uint64_t seed = 1;
+  int count = 0;
+  int threads = 2;
+  double weight = 2;
+  size_t memory_limit = size_t(64) << 20;
+  long long node_limit = 2000000;
+  double time_limit = 10;
+  bool json = false;
+  bool fork = true;
+  bool symmetry = false;
+};
+
+struct Result {
+  bool solved;
+  char status[64];
+  int length;
+  long long nodes;
+  double seconds;
+  long peak_rss_kb;
+  SideStats stats;
+};
+
+// Размер набора по умолчанию, если не задан --count.
+int DefaultCount(const std::string& set) {
+  if (set == "3x3") return 100;
+  if (set == "3x4") return 30;
+  if (set == "4x4") return 10;
+  if (set == "korf") return KORF_INSTANCE_COUNT;
+  return 20;
+}
+
+std::vector<std::string> Split(const std::string& text) {
+  std::vector<std::string> parts;
+  std::stringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, ',')) {
+    if (!part.empty()) parts.push_back(part);
+  }
+  return parts;
+}
+
+std::unique_ptr<Heuristic> MakeHeuristic(const std::string& name,
+                                         const PatternDatabase* database) {
+  if (name == "linear") return std::unique_ptr<Heuristic>(new LinearConflictHeuristic());
+  if (name == "wd") return std::unique_ptr<Heuristic>(new WalkingDistanceHeuristic());
+  if (name == "pdb" && database) {
+    return std::unique_ptr<Heuristic>(new PatternDatabaseHeuristic(*database));
+  }
+  if (name == "pdbsym" && database) {
+    return std::unique_ptr<Heuristic>(
+        new SymmetricHeuristic(PatternDatabaseHeuristic(*database)));
+  }
+  if (name == "manhattan") return std::unique_ptr<Heuristic>(new ManhattanHeuristic());
+  return std::unique_ptr<Heuristic>();
+}
+
+bool KnownEngine(const std::string& name) {
+  return name == "astar" || name == "astar2" || name == "ida" ||
+         name == "hda" || name == "pida" || name == "wastar" || name == "ara" ||
+         name == "mm" || name == "bounded";
+}
+
+Result Run(const Instance& instance, const std::string& engine,
+           const Heuristic* heuristic, const Options& options) {
+  Result result;
+  std::string msg;
+  std::vector<Position> way;
+  auto start = std::chrono::steady_clock::now();
+  if (engine == "astar" || engine == "astar2") {
+    AStarSearcher searcher;
+    searcher.SetHeuristic(heuristic);
+    searcher.SetConcurrent(engine == "astar2");
+    searcher.SetTimeLimit(options.time_limit);
+    way = searcher.Search(instance.source, instance.goal, options.node_limit, msg);
+    result.nodes = searcher.NodesExpanded();
+    result.stats = searcher.Stats().Total();
+  } else if (engine == "ida") {
+    IDAStarSearcher searcher;
+    searcher.SetHeuristic(heuristic);
+    searcher.SetTimeLimit(options.time_limit);
+    way = searcher.Search(instance.source, instance.goal, options.node_limit, msg);
+    result.nodes = searcher.NodesExpanded();
+    result.stats = searcher.Stats().Total();
+  } else if (engine == "hda") {
+    HDAStarSearcher searcher;
+    searcher.SetThreads(options.threads);
+    searcher.SetHeuristic(heuristic);
+    searcher.SetTimeLimit(options.time_limit);
+    way = searcher.Search(instance.source, instance.goal, options.node_limit, msg);
+    result.nodes = searcher.NodesExpanded();
+    result.stats = searcher.Stats().Total();
+  } else if (engine == "wastar" || engine == "ara") {
+    ARAStarSearcher searcher;
+    searcher.SetHeuristic(heuristic);
+    searcher.SetWeight(options.weight);
+    searcher.SetAnytime(engine == "ara");
+    searcher.SetSymmetry(options.symmetry);
+    searcher.SetTimeLimit(options.time_limit);
+    way = searcher.Search(instance.source, instance.goal, options.node_limit, msg);
+    result.nodes = searcher.NodesExpanded();
+    result.stats = searcher.Stats().Total();
+  } else if (engine == "mm") {
+    MMSearcher searcher;
+    searcher.SetHeuristic(heuristic);
+    searcher.SetTimeLimit(options.time_limit);
+    way = searcher.Search(instance.source, instance.goal, options.node_limit, msg);
+    result.nodes = searcher.NodesExpanded();
+    result.stats = searcher.Stats().Total();
+  } else if (engine == "bounded") {
+    MemoryBoundedSearcher searcher;
+    searcher.SetHeuristic(heuristic);
+    searcher.SetMemoryLimit(options.memory_limit);
+    searcher.SetSymmetry(options.symmetry);
+    searcher.SetTimeLimit(options.time_limit);
+    way = searcher.Search(instance.source, instance.goal, options.node_limit, msg);
+    result.nodes = searcher.NodesExpanded();
+    result.stats = searcher.Stats().Total();
+  } else {
+    ParallelIDAStarSearcher searcher;
+    searcher.SetThreads(options.threads);
+    searcher.SetHeuristic(heuristic);
+    searcher.SetTimeLimit(options.time_limit);
+    way = searcher.Search(instance.source, instance.goal, options.node_limit, msg);
+    result.nodes = searcher.NodesExpanded();
+    result.stats = searcher.Stats().Total();
+  }
+  result.seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+  result.solved = !way.empty();
+  result.length = way.empty() ? -1 : int(way.size()) - 1;
+  if (msg.empty()) msg = "ok";
+  strncpy(result.status, msg.c_str(), sizeof(result.status) - 1);
+  result.status[sizeof(result.status) - 1] = '\0';
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  result.peak_rss_kb = usage.ru_maxrss;
+  return result;
+}
+
+// Запуск в дочернем процессе; результат передается через канал.
+Result RunIsolated(const Instance& instance, const std::string& engine,
+                   const Heuristic* heuristic, const Options& options) {
+  int channel[2];
+  if (!options.fork || pipe(channel) != 0) {
+    return Run(instance, engine, heuristic, options);
+  }
+  pid_t child = fork();
+  if (child < 0) {
+    close(channel[0]);
+    close(channel[1]);
+    return Run(instance, engine, heuristic, options);
+  }
+  if (child == 0) {
+    close(channel[0]);
+    Result result = Run(instance, engine, heuristic, options);
+    ssize_t written = write(channel[1], &result, sizeof(result));
+    _exit(written == ssize_t(sizeof(result)) ? 0 : 1);
+  }
+  close(channel[1]);
+  Result result;
+  ssize_t size = read(channel[0], &result, sizeof(result));
+  close(channel[0]);
+  int status = 0;
+  waitpid(child, &status, 0);
+  if (size != ssize_t(sizeof(result))) {
+    result = Result();
+    result.length = -1;
+    strcpy(result.status, "Crashed");
+  }
+  return result;
+}
+
+std::string Escape(const std::string& text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\') escaped += '\\';
+    escaped += c;
+  }
+  return escaped;
+}
+
+void PrintUsage(const char* name) {
+  std::cerr
+      << "Usage: " << name << " [options]\n"
+      << "  --sets a,b        instance sets (3x3,3x4,4x4,stones,duplicates,\n"
+      << "                    korf - Korf's 100 15-puzzle instances, built in)\n"
+      << "  --korf file       add more instances in Korf's format"
+      << " (\"n t0 .. t15\", blank-first goal)\n"
+      << "  --instances file  add instances in 15solver --batch text format\n"
+      << "  --engines a,b     astar,astar2,ida,hda,pida,wastar,ara,mm,\n"
+      << "                    bounded\n"
+      << "  --heuristics a,b  manhattan,linear,wd,pdb,pdbsym (pdb with reflected\n"
+      << "                    lookups)\n"
+      << "  --pdb file        pattern database for the pdb heuristic\n"
+      << "  --seed n --count n --threads n --nodes n --time-ms n\n"
+      << "  --weight w        heuristic weight for wastar and ara\n"
+      << "  --memory-mb n     memory budget of bounded (default 64)\n"
+      << "  --symmetry        wastar, ara and bounded store one position per\n"
+      << "                    goal symmetry orbit (pdb becomes pdbsym)\n"
+      << "  --format csv|json --no-fork\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--sets" && has_value) {
+      options.sets = Split(argv[++i]);
+    } else if (arg == "--korf" && has_value) {
+      options.korf_file = argv[++i];
+    } else if (arg == "--instances" && has_value) {
+      options.instance_file = argv[++i];
+    } else if (arg == "--engines" && has_value) {
+      options.engines = Split(argv[++i]);
+    } else if (arg == "--heuristics" && has_value) {
+      options.heuristics = Split(argv[++i]);
+    } else if (arg == "--pdb" && has_value) {
+      options.pdb_file = argv[++i];
+    } else if (arg == "--seed" && has_value) {
+      options.seed = strtoull(argv[++i], 0, 10);
+    } else if (arg == "--count" && has_value) {
+      options.count = atoi(argv[++i]);
+    } else if (arg == "--threads" && has_value) {
+      options.threads = atoi(argv[++i]);
+    } else if (arg == "--weight" && has_value) {
+      options.weight = atof(argv[++i]);
+    } else if (arg == "--memory-mb" && has_value) {
+      options.memory_limit = size_t(atof(argv[++i]) * 1024 * 1024);
+    } else if (arg == "--nodes" && has_value) {
+      options.node_limit = atoll(argv[++i]);
+    } else if (arg == "--time-ms" && has_value) {
+      options.time_limit = atof(argv[++i]) / 1000;
+    } else if (arg == "--format" && has_value) {
+      options.json = std::string(argv[++i]) == "json";
+    } else if (arg == "--no-fork") {
+      options.fork = false;
+    } else if (arg == "--symmetry") {
+      options.symmetry = true;
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (options.threads < 1 || options.threads > HDAStarSearcher::MAX_THREADS ||
+      !(options.weight >= 1)) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  // Задачи с именем набора.
+  std::vector<std::pair<std::string, Instance>> instances;
+  for (const std::string& set : options.sets) {
+    std::vector<Instance> generated;
+    int count = options.count > 0 ? options.count : DefaultCount(set);
+    if (!MakeInstanceSet(set, options.seed, count, generated)) {
+      std::cerr << "Unknown set " << set << std::endl;
+      return 1;
+    }
+    for (const Instance& instance : generated) {
+      instances.push_back(std::make_pair(set, instance));
+    }
+  }
+  std::string msg;
+  if (!options.korf_file.empty()) {
+    std::vector<Instance> korf;
+    if (!LoadKorfInstances(options.korf_file, korf, msg)) {
+      std::cerr << msg << std::endl;
+      return 1;
+    }
+    for (const Instance& instance : korf) {
+      instances.push_back(std::make_pair(std::string("korf"), instance));
+    }
+  }
+  if (!options.instance_file.empty()) {
+    std::ifstream input(options.instance_file.c_str());
+    if (!input) {
+      std::cerr << "Can't open " << options.instance_file << std::endl;
+      return 1;
+    }
+    std::string line;
+    while (std::getline(input, line)) {
+      size_t first = line.find_first_not_of(" \t\r");
+      if (first == std::string::npos || line[first] == '#') continue;
+      Instance instance;
+      if (!ParseInstance(line, instance, msg)) {
+        std::cerr << msg << ": " << line << std::endl;
+        return 1;
+      }
+      instances.push_back(std::make_pair(std::string("file"), instance));
+    }
+  }
+
+  PatternDatabase database;
+  bool has_database = false;
+  if (!options.pdb_file.empty()) {
+    if (!database.Load(options.pdb_file, msg)) {
+      std::cerr << msg << std::endl;
+      return 1;
+    }
+    has_database = true;
+  }
+  for (const std::string& engine : options.engines) {
+    if (!KnownEngine(engine)) {
+      std::cerr << "Unknown engine " << engine << std::endl;
+      return 1;
+    }
+  }
+  for (const std::string& name : options.heuristics) {
+    if (!MakeHeuristic(name, has_database ? &database : 0)) {
+      std::cerr << "Unknown heuristic " << name
+                << (name.compare(0, 3, "pdb") == 0 ? " (needs --pdb)" : "") << std::endl;
+      return 1;
+    }
+  }
+
+  if (options.json) {
+    std::cout << "[" << std::endl;
+  } else {
+    std::cout << "set,instance,engine,heuristic,status,length,nodes,ms,"
+                 "nodes_per_sec,peak_rss_kb,generated,duplicates,reopened,"
+                 "peak_opened,closed" << std::endl;
+  }
+  bool first = true;
+  for (const std::string& engine : options.engines) {
+    for (const std::string& name : options.heuristics) {
+      // База шаблонов не симметрична, поэтому при --symmetry к ней, как в
+      // 15solver, добавляются просмотры отраженных позиций.
+      std::unique_ptr<Heuristic> heuristic = MakeHeuristic(
+          options.symmetry && name == "pdb" ? "pdbsym" : name,
+          has_database ? &database : 0);
+      for (const auto& entry : instances) {
+        Result result =
+            RunIsolated(entry.second, engine, heuristic.get(), options);
+        double rate = result.seconds > 0 ? result.nodes / result.seconds : 0;
+        long long ms = (long long)(result.seconds * 1000 + 0.5);
+        if (options.json) {
+          std::cout << (first ? "" : ",\n") << "  {\"set\": \"" << entry.first
+                    << "\", \"instance\": \"" << Escape(entry.second.id)
+                    << "\", \"engine\": \"" << engine
+                    << "\", \"heuristic\": \"" << name
+                    << "\", \"status\": \"" << Escape(result.status)
+                    << "\", \"length\": " << result.length
+                    << ", \"nodes\": " << result.nodes << ", \"ms\": " << ms
+                    << ", \"nodes_per_sec\": " << (long long)rate
+                    << ", \"peak_rss_kb\": " << result.peak_rss_kb
+                    << ", \"generated\": " << result.stats.generated
+                    << ", \"duplicates\": " << result.stats.duplicates
+                    << ", \"reopened\": " << result.stats.reopened
+                    << ", \"peak_opened\": " << result.stats.peak_opened
+                    << ", \"closed\": " << result.stats.closed << "}";
+        } else {
+          std::cout << entry.first << ',' << entry.second.id << ',' << engine
+                    << ',' << name << ',' << result.status << ','
+                    << result.length << ',' << result.nodes << ',' << ms << ','
+                    << (long long)rate << ',' << result.peak_rss_kb << ','
+                    << result.stats.generated << ','
+                    << result.stats.duplicates << ','
+                    << result.stats.reopened << ','
+                    << result.stats.peak_opened << ','
+                    << result.stats.closed << std::endl;
+        }
+        first = false;
+      }
+    }
+  }
+  if (options.json) {
+    std::cout << (first ? "" : "\n") << "]" << std::endl;
+  }
+  return 0;
+}
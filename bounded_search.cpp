@@ -0,0 +1,284 @@
+#include "bounded_search.h"
+#include "reachability.h"
+#include <algorithm>
+#include <climits>
+
+const int MemoryBoundedSearcher::FOUND = -1;
+const int MemoryBoundedSearcher::NOT_FOUND = INT_MAX;
+
+MemoryBoundedSearcher::MemoryBoundedSearcher()
+    : reuse_arena_( false), heuristic_( 0), memory_limit_( 0), use_symmetry_( false), time_limit_( 0), control_( 0), bytes_limit_( 0),
+      interrupted_( NOT_STOPPED), symmetric_( false), pool_( arena_), opened_set_( arena_), goal_vertex_( NO_NODE), frontier_size_( 0), best_h_( 0), best_root_( NO_NODE) {
+}
+
+const Position& MemoryBoundedSearcher::Key( const Position& position) {
+    if ( !symmetric_ ) {
+        return position;
+    }
+    canonical_ = symmetry_.Canonical( position);
+    return canonical_;
+}
+
+size_t MemoryBoundedSearcher::MemoryUsage() const {
+    return arena_.Capacity() + pool_.Capacity() + opened_set_.Capacity();
+}
+
+void MemoryBoundedSearcher::Report() {
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    progress_( stats_);
+    return;
+}
+
+bool MemoryBoundedSearcher::CountExpansion() {
+    SideStats& stats = stats_.sides[SearchStats::SOURCE];
+    if ( stats.expanded >= budget_.NodeLimit() ) {
+        interrupted_ = NODE_LIMIT;
+        return false;
+    }
+    if ( !(++stats.expanded % CHECK_PERIOD) ) {
+        if ( progress_ ) {
+            Report();
+        }
+        // Ограничение памяти уже учтено в bytes_limit_ и ведет к IDA*, а не к остановке.
+        interrupted_ = budget_.Check( 0);
+    }
+    return interrupted_ == NOT_STOPPED;
+}
+
+MemoryBoundedSearcher::Phase MemoryBoundedSearcher::BestFirst() {
+    SideStats& stats = stats_.sides[SearchStats::SOURCE];
+    Position::MoveList moves;
+    while ( !opened_set_.Empty() ) {
+        NodeIndex current = opened_set_.ExtractMin();
+        if ( !arena_[current].h && (arena_[current].position == goal_) ) {
+            goal_vertex_ = current;
+            return SOLVED;
+        }
+        Position position = arena_[current].position;
+        {
+            ProfileScope scope( stats.move_generation_seconds);
+            position.GetPossibleMoves( neighbors_, moves);
+        }
+        // Раскрытие может добавить moves.Size() вершин, а переход к IDA*
+        // потребует списка корней по 4 байта на вершину очереди.
+        size_t count = size_t( moves.Size());
+        if ( bytes_limit_
+             && (arena_.CapacityAfter( count) + pool_.PeakCapacity( count) + opened_set_.Capacity()
+                 + (opened_set_.Size() + count) * sizeof( NodeIndex) > bytes_limit_) ) {
+            opened_set_.Insert( current);
+            return OUT_OF_MEMORY;
+        }
+        if ( !CountExpansion() ) {
+            opened_set_.Insert( current);
+            return STOPPED;
+        }
+        stats.generated += moves.Size();
+        int cost = arena_[current].cost + 1;
+        for ( int index = 0; index < moves.Size(); ++index ) {
+            const Position::Move& move = moves[index];
+            position.Swap( move.from, move.to);
+            const Position& key = Key( position);
+            NodeIndex next;
+            {
+                ProfileScope scope( stats.lookup_seconds);
+                next = pool_.Find( key);
+            }
+            if ( next == NO_NODE ) {
+                int h;
+                {
+                    ProfileScope scope( stats.heuristic_seconds);
+                    h = symmetric_ ? prepared_->Distance( key) : prepared_->UpdateDistance( position, arena_[current].h, move.from, move.to);
+                }
+                ++stats.heuristic_evaluations;
+                next = arena_.Allocate( key, cost, h, cost + h, current);
+                pool_.Insert( next);
+                opened_set_.Insert( next);
+            } else {
+                ++stats.duplicates;
+                if ( opened_set_.Contains( next) && (arena_[next].cost > cost) ) {
+                    ++stats.reopened;
+                    opened_set_.DecreaseKey( next, cost);
+                    arena_[next].parent = current;
+                }
+            }
+            position.Swap( move.from, move.to);
+        }
+        stats.peak_opened = std::max( stats.peak_opened, opened_set_.Size());
+    }
+    return EXHAUSTED;
+}
+
+int MemoryBoundedSearcher::DepthSearch( int cost, int h, int threshold) {
+    if ( cost + h > threshold ) {
+        return cost + h;
+    }
+    if ( !h && (position_ == goal_) ) {
+        return FOUND;
+    }
+    if ( !CountExpansion() ) {
+        return NOT_FOUND;
+    }
+    if ( h < best_h_ ) {
+        best_h_ = h;
+        best_path_ = path_;
+    }
+    SideStats& stats = stats_.sides[SearchStats::SOURCE];
+    Position::MoveList& moves = moves_[path_.size()];
+    {
+        ProfileScope scope( stats.move_generation_seconds);
+        position_.GetPossibleMoves( neighbors_, moves);
+    }
+    int next_threshold = NOT_FOUND;
+    for ( int index = 0; index < moves.Size(); ++index ) {
+        const Position::Move* move = &moves[index];
+        if ( !path_.empty() && (path_.back() == *move) ) {
+            continue;
+        }
+        position_.Swap( move->from, move->to);
+        ++stats.generated;
+        NodeIndex stored;
+        {
+            ProfileScope scope( stats.lookup_seconds);
+            stored = pool_.Find( Key( position_));
+        }
+        if ( (stored != NO_NODE) && (arena_[stored].cost <= cost + 1) ) {
+            ++stats.duplicates;
+            position_.Swap( move->from, move->to);
+            continue;
+        }
+        int next_h;
+        {
+            ProfileScope scope( stats.heuristic_seconds);
+            next_h = prepared_->UpdateDistance( position_, h, move->from, move->to);
+        }
+        ++stats.heuristic_evaluations;
+        path_.push_back( *move);
+        int result = DepthSearch( cost + 1, next_h, threshold);
+        if ( result == FOUND ) {
+            return FOUND;
+        }
+        path_.pop_back();
+        position_.Swap( move->from, move->to);
+        next_threshold = std::min( next_threshold, result);
+    }
+    return next_threshold;
+}
+
+std::vector<Position> MemoryBoundedSearcher::Search( const Position& source, const Position& goal, long long limit, std::string& error_msg) {
+    error_msg = "";
+    std::vector<Position> way;
+    stats_.Clear();
+    partial_.clear();
+    if ( !CheckReachability( source, goal, error_msg) ) {
+        return way;
+    }
+    start_ = std::chrono::steady_clock::now();
+    budget_.Start( control_, limit, time_limit_);
+    bytes_limit_ = memory_limit_;
+    if ( budget_.MemoryLimit() && (!bytes_limit_ || (budget_.MemoryLimit() < bytes_limit_)) ) {
+        bytes_limit_ = budget_.MemoryLimit();
+    }
+    interrupted_ = NOT_STOPPED;
+    goal_vertex_ = NO_NODE;
+    frontier_size_ = 0;
+    best_h_ = INT_MAX;
+    best_root_ = NO_NODE;
+    goal_ = goal;
+    neighbors_ = NeighborTable( source);
+    symmetric_ = use_symmetry_ && symmetry_.Detect( goal);
+    const Position& start = Key( source);
+    prepared_ = PrepareHeuristic( heuristic_, goal);
+    int h = prepared_->Distance( start);
+    stats_.sides[SearchStats::SOURCE].heuristic_evaluations = 1;
+    NodeIndex root = arena_.Allocate( start, 0, h, h, NO_NODE);
+    pool_.Insert( root);
+    opened_set_.Insert( root);
+    Phase phase = BestFirst();
+    NodeIndex found_root = NO_NODE;
+    if ( phase == OUT_OF_MEMORY ) {
+        // Корни IDA* по возрастанию g + h, из равных - с большим g.
+        std::vector<NodeIndex> frontier;
+        frontier.reserve( opened_set_.Size());
+        while ( !opened_set_.Empty() ) {
+            frontier.push_back( opened_set_.ExtractMin());
+        }
+        frontier_size_ = frontier.size();
+        int threshold = arena_[frontier.front()].heuristic;
+        while ( (found_root == NO_NODE) && (interrupted_ == NOT_STOPPED) && (threshold != NOT_FOUND) ) {
+            int next_threshold = NOT_FOUND;
+            if ( moves_.size() <= size_t( threshold) ) {
+                moves_.resize( threshold + 1);
+            }
+            for ( size_t index = 0; index < frontier.size(); ++index ) {
+                const Vertex& vertex = arena_[frontier[index]];
+                if ( vertex.heuristic > threshold ) {
+                    next_threshold = std::min( next_threshold, vertex.heuristic);
+                    break;
+                }
+                position_ = vertex.position;
+                path_.clear();
+                int best_h = best_h_;
+                int result = DepthSearch( vertex.cost, vertex.h, threshold);
+                if ( best_h_ < best_h ) {
+                    best_root_ = frontier[index];
+                }
+                if ( result == FOUND ) {
+                    found_root = frontier[index];
+                    break;
+                }
+                if ( interrupted_ != NOT_STOPPED ) {
+                    break;
+                }
+                next_threshold = std::min( next_threshold, result);
+            }
+            threshold = next_threshold;
+        }
+    }
+    SideStats& stats = stats_.sides[SearchStats::SOURCE];
+    stats.closed = pool_.Size() - opened_set_.Size() - frontier_size_;
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    // Путь по сохраненным вершинам до vertex и затем по ходам moves.
+    auto trace = [&]( NodeIndex vertex, const std::vector<Position::Move>& moves, std::vector<Position>& result) {
+        if ( vertex == NO_NODE ) {
+            return;
+        }
+        for ( ; vertex != NO_NODE; vertex = arena_[vertex].parent ) {
+            result.push_back( arena_[vertex].position);
+        }
+        std::reverse( result.begin(), result.end());
+        Position position = result.back();
+        for ( size_t index = 0; index < moves.size(); ++index ) {
+            position.Swap( moves[index].from, moves[index].to);
+            result.push_back( position);
+        }
+        // Сохраненные позиции - представители орбит, ходы IDA* - от представителя корня.
+        if ( symmetric_ ) {
+            result = symmetry_.Unfold( source, result);
+        }
+    };
+    if ( phase == SOLVED ) {
+        trace( goal_vertex_, std::vector<Position::Move>(), way);
+    } else if ( found_root != NO_NODE ) {
+        trace( found_root, path_, way);
+    } else if ( interrupted_ != NOT_STOPPED ) {
+        error_msg = StopMessage( interrupted_);
+        if ( best_root_ != NO_NODE ) {
+            trace( best_root_, best_path_, partial_);
+        } else {
+            trace( BestOpened( arena_), std::vector<Position::Move>(), partial_);
+        }
+    } else {
+        error_msg = "No solution";
+    }
+    opened_set_.Clear();
+    if ( reuse_arena_ ) {
+        pool_.Clear();
+        arena_.Clear();
+    } else {
+        opened_set_.Release();
+        pool_.Release();
+        arena_.Release();
+        std::vector<Position::MoveList>().swap( moves_);
+    }
+    return way;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#ifndef _BOUNDED_SEARCH_H_
+#define _BOUNDED_SEARCH_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include "position.h"
+#include "heuristic.h"
+#include "search.h"
+#include "search_stats.h"
+#include "search_control.h"
+#include "symmetry.h"
+
+// A* с ограниченной памятью. Пока арена, таблица и очередь умещаются в
+// заданный объем, это обычный однонаправленный A*. Когда следующее раскрытие
+// вышло бы за ограничение, поиск переходит к IDA*, корнями которого служат
+// вершины очереди по возрастанию оценки: на каждом пороге из каждого корня с
+// g + h <= порога выполняется поиск в глубину. Сохраненные вершины отсекают
+// повторы: позиция, достигнутая не короче, чем записано в таблице, уже
+// покрыта другим корнем. Решение остается кратчайшим при монотонной оценке,
+// а при нехватке памяти поиск замедляется вместо ее исчерпания.
+class MemoryBoundedSearcher {
+public:
+    MemoryBoundedSearcher();
+    void SetReuseArena( bool reuse) {reuse_arena_ = reuse;}
+    void SetHeuristic( const Heuristic* heuristic) {heuristic_ = heuristic;}
+    // Память арены, таблицы и очереди в байтах, после которой поиск переходит
+    // к IDA*; 0 - без ограничения. Действует и ограничение памяти SetControl,
+    // если оно меньше: поиск с ним не прерывается, а переходит к IDA*.
+    // Арена занимает память кусками по VertexArena::CHUNK_SIZE вершин, поэтому
+    // при ограничении меньше одного куска A* не раскрывает ни одной вершины и
+    // поиск сразу становится IDA* от начальной позиции.
+    void SetMemoryLimit( size_t bytes) {memory_limit_ = bytes;}
+    // Хранить по одной позиции на орбиту симметрий цели, как в ARAStarSearcher;
+    // IDA* отсекает позицию и по сохраненному представителю ее орбиты.
+    void SetSymmetry( bool symmetry) {use_symmetry_ = symmetry;}
+    void SetTimeLimit( double seconds) {time_limit_ = seconds;}
+    void SetControl( const SearchControl* control) {control_ = control;}
+    // Число раскрытых вершин обеих фаз.
+    long long NodesExpanded() const {return stats_.Expanded();}
+    // Статистика (сторона SOURCE); duplicates включает позиции IDA*, отсеченные таблицей.
+    const SearchStats& Stats() const {return stats_;}
+    // Вызывается раз в 1024 раскрытых вершины.
+    void SetProgress( const ProgressCallback& progress) {progress_ = progress;}
+    // Число корней IDA* в последнем поиске, 0 - хватило памяти для A*.
+    size_t FrontierSize() const {return frontier_size_;}
+    std::vector<Position> Search( const Position& source, const Position& goal, long long limit, std::string& error_msg);
+    const std::vector<Position>& BestPartial() const {return partial_;}
+private:
+    MemoryBoundedSearcher( const MemoryBoundedSearcher&);
+    MemoryBoundedSearcher& operator=( const MemoryBoundedSearcher&);
+    // Итог фазы A*.
+    enum Phase { SOLVED, EXHAUSTED, OUT_OF_MEMORY, STOPPED };
+    Phase BestFirst();
+    // Поиск в глубину от текущей position_; возвращает FOUND или наименьшую
+    // оценку за порогом, NOT_FOUND при остановке.
+    int DepthSearch( int cost, int h, int threshold);
+    // Учитывает раскрытие и проверяет ограничения; false - поиск остановлен.
+    bool CountExpansion();
+    size_t MemoryUsage() const;
+    // Представитель орбиты позиции при symmetric_, иначе сама позиция;
+    // ссылка действительна до следующего вызова.
+    const Position& Key( const Position& position);
+    void Report();
+    const static int FOUND;
+    const static int NOT_FOUND;
+    bool reuse_arena_;
+    const Heuristic* heuristic_;
+    size_t memory_limit_;
+    bool use_symmetry_;
+    double time_limit_;
+    const SearchControl* control_;
+    SearchBudget budget_;
+    // Ограничение памяти текущего поиска с учетом SetControl, 0 - нет.
+    size_t bytes_limit_;
+    StopReason interrupted_;
+    SearchStats stats_;
+    ProgressCallback progress_;
+    std::chrono::steady_clock::time_point start_;
+    std::unique_ptr<Heuristic> prepared_;
+    Position goal_;
+    NeighborTable neighbors_;
+    SymmetryGroup symmetry_;
+    bool symmetric_;
+    Position canonical_;
+    VertexArena arena_;
+    VertexPool pool_;
+    OpenedSet opened_set_;
+    NodeIndex goal_vertex_;
+    size_t frontier_size_;
+    // Состояние IDA*: позиция, ходы от корня и буферы ходов по глубине.
+    Position position_;
+    std::vector<Position::Move> path_;
+    std::vector<Position::MoveList> moves_;
+    // Вершина IDA* с наименьшей оценкой: корень и ходы от него.
+    int best_h_;
+    NodeIndex best_root_;
+    std::vector<Position::Move> best_path_;
+    std::vector<Position> partial_;
+};
+
+#endif /* _BOUNDED_SEARCH_H_ */
@@ -1,5 +1,30 @@
-g++ -O2 -c search.cpp -o search.o
+g++ --std=c++0x -O2 -pthread -c search.cpp -o search.o
+g++ --std=c++0x -O2 -c search_stats.cpp -o search_stats.o
+g++ --std=c++0x -O2 -c search_control.cpp -o search_control.o
 g++ -O2 -c position.cpp -o position.o
+g++ --std=c++0x -O2 -c reachability.cpp -o reachability.o
+g++ --std=c++0x -O2 -pthread -c ida_search.cpp -o ida_search.o
+g++ -O2 -c pattern_database.cpp -o pattern_database.o
+g++ --std=c++0x -O2 -c heuristic.cpp -o heuristic.o
+g++ --std=c++0x -O2 -pthread -c hda_search.cpp -o hda_search.o
+g++ --std=c++0x -O2 -pthread -c parallel_ida_search.cpp -o parallel_ida_search.o
+g++ --std=c++0x -O2 -c ara_search.cpp -o ara_search.o
+g++ --std=c++0x -O2 -c mm_search.cpp -o mm_search.o
+g++ --std=c++0x -O2 -c bounded_search.cpp -o bounded_search.o
+g++ --std=c++0x -O2 -c planner_session.cpp -o planner_session.o
+g++ --std=c++0x -O2 -c symmetry.cpp -o symmetry.o
+g++ --std=c++0x -O2 -c solution.cpp -o solution.o
+g++ --std=c++0x -O2 -c distance_table.cpp -o distance_table.o
+g++ --std=c++0x -O2 -c solution_cache.cpp -o solution_cache.o
+g++ --std=c++0x -O2 -pthread -c thread_pool.cpp -o thread_pool.o
+g++ --std=c++0x -O2 -pthread -c batch.cpp -o batch.o
+g++ --std=c++0x -O2 -c instances.cpp -o instances.o
 g++ --std=c++0x -O2 -c main.cpp -o main.o
-g++ search.o position.o main.o -o 15solver
+g++ --std=c++0x -O2 -c benchmark.cpp -o benchmark.o
+g++ --std=c++0x -O2 -c pdb_build.cpp -o pdb_build.o
+g++ --std=c++0x -O2 -c table_build.cpp -o table_build.o
+g++ -pthread search.o search_stats.o search_control.o position.o reachability.o ida_search.o pattern_database.o heuristic.o hda_search.o parallel_ida_search.o ara_search.o mm_search.o bounded_search.o planner_session.o symmetry.o solution.o distance_table.o solution_cache.o thread_pool.o batch.o main.o -o 15solver
+g++ -pthread search.o search_stats.o search_control.o position.o reachability.o ida_search.o pattern_database.o heuristic.o hda_search.o parallel_ida_search.o ara_search.o mm_search.o bounded_search.o planner_session.o symmetry.o solution.o distance_table.o solution_cache.o thread_pool.o batch.o instances.o benchmark.o -o 15bench
+g++ position.o pattern_database.o pdb_build.o -o 15pdb
+g++ position.o solution.o distance_table.o table_build.o -o 15table
 rm -f *.o
@@ -0,0 +1,455 @@
+#include "distance_table.h"
+#include <stdexcept>
+#include <algorithm>
+#include <queue>
+#include <cstring>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const uint32_t DistanceTable::VERSION = 1;
+
+namespace {
+
+const char MAGIC[8] = {'1', '5', 'D', 'S', 'T', '\n', 0, 0};
+// Ограничения размера поля и значений фишек, защита от испорченного файла.
+const int MAX_CELLS = 1 << 16;
+const int MAX_VALUE = 1 << 16;
+
+uint64_t Factorial( int count) {
+    uint64_t result = 1;
+    for ( int i = 2; i <= count; ++i ) {
+        result *= uint64_t( i);
+    }
+    return result;
+}
+
+// Размер заголовка файла для поля из cells клеток: MAGIC, VERSION, height,
+// width, клетки цели, число номеров и наибольшая глубина.
+size_t HeaderSize( int cells) {
+    return sizeof( MAGIC) + 3 * sizeof( uint32_t) + cells * sizeof( int32_t) + sizeof( uint64_t) + sizeof( uint32_t);
+}
+
+template <class T>
+bool Read( const unsigned char*& data, const unsigned char* end, T& value) {
+    if ( size_t( end - data) < sizeof( T) ) {
+        return false;
+    }
+    std::memcpy( &value, data, sizeof( T));
+    data += sizeof( T);
+    return true;
+}
+
+template <class T>
+bool Write( FILE* file, const T& value) {
+    return fwrite( &value, sizeof( T), 1, file) == 1;
+}
+
+// Отсортированный файл номеров, читаемый по одному.
+struct Run {
+    FILE* file;
+    uint32_t value;
+    bool Next() {return fread( &value, sizeof( value), 1, file) == 1;}
+};
+
+struct RunGreater {
+    bool operator()( const Run* left, const Run* right) const {return left->value > right->value;}
+};
+
+} // namespace
+
+DistanceTable::DistanceTable()
+    : blank_label_( 0), goal_rank_( 0), states_( 0), max_depth_( 0), bits_( 0), mapping_( 0), mapping_size_( 0) {
+}
+
+DistanceTable::~DistanceTable() {
+    Clear();
+}
+
+void DistanceTable::Clear() {
+    free_cells_.clear();
+    free_index_.clear();
+    label_.clear();
+    states_ = 0;
+    max_depth_ = 0;
+    bits_ = 0;
+    if ( mapping_ ) {
+        munmap( mapping_, mapping_size_);
+        mapping_ = 0;
+        mapping_size_ = 0;
+    }
+    return;
+}
+
+bool DistanceTable::Index( const Position& goal) {
+    goal_ = goal;
+    int cells = goal.Height() * goal.Width();
+    free_cells_.clear();
+    free_index_.assign( cells, -1);
+    std::vector<int> values;
+    for ( int cell = 0; cell < cells; ++cell ) {
+        if ( goal.GetField( cell) != Position::STONE ) {
+            free_index_[cell] = int( free_cells_.size());
+            free_cells_.push_back( cell);
+            values.push_back( goal.GetField( cell));
+        }
+    }
+    std::sort( values.begin(), values.end());
+    if ( values.empty() || (values.size() > size_t( MAX_FREE_CELLS)) || (values.front() != Position::BLANK)
+         || (values.back() > MAX_VALUE) || (std::adjacent_find( values.begin(), values.end()) != values.end()) ) {
+        return false;
+    }
+    label_.assign( values.back() + 1, -1);
+    for ( size_t index = 0; index < values.size(); ++index ) {
+        label_[values[index]] = int( index);
+    }
+    blank_label_ = label_[Position::BLANK];
+    neighbors_ = NeighborTable( goal);
+    states_ = Factorial( int( free_cells_.size()));
+    int labels[MAX_FREE_CELLS];
+    Labels( goal, labels);
+    goal_rank_ = Rank( labels);
+    return true;
+}
+
+bool DistanceTable::Labels( const Position& position, int* labels) const {
+    if ( (position.Height() != goal_.Height()) || (position.Width() != goal_.Width()) ) {
+        return false;
+    }
+    uint32_t used = 0;
+    for ( int cell = 0; cell < int( free_index_.size()); ++cell ) {
+        int value = position.GetField( cell);
+        int index = free_index_[cell];
+        if ( index < 0 ) {
+            // Камни должны стоять на тех же местах.
+            if ( value != Position::STONE ) {
+                return false;
+            }
+            continue;
+        }
+        if ( (value < 0) || (value >= int( label_.size())) || (label_[value] < 0) || ((used >> label_[value]) & 1) ) {
+            return false;
+        }
+        labels[index] = label_[value];
+        used |= 1u << labels[index];
+    }
+    return true;
+}
+
+// Номер перестановки в лексикографическом порядке, последняя клетка - младший разряд.
+uint32_t DistanceTable::Rank( const int* labels) const {
+    int count = int( free_cells_.size());
+    uint32_t result = 0;
+    uint32_t used = 0;
+    for ( int i = 0; i < count; ++i ) {
+        int digit = labels[i] - __builtin_popcount( used & ((1u << labels[i]) - 1));
+        result = result * uint32_t( count - i) + uint32_t( digit);
+        used |= 1u << labels[i];
+    }
+    return result;
+}
+
+void DistanceTable::Unrank( uint32_t rank, int* labels) const {
+    int count = int( free_cells_.size());
+    int digits[MAX_FREE_CELLS];
+    for ( int i = count - 1; i >= 0; --i ) {
+        digits[i] = int( rank % uint32_t( count - i));
+        rank /= uint32_t( count - i);
+    }
+    uint32_t used = 0;
+    for ( int i = 0; i < count; ++i ) {
+        int label = -1;
+        for ( int skip = digits[i]; skip >= 0; --skip ) {
+            do {
+                ++label;
+            } while ( (used >> label) & 1 );
+        }
+        labels[i] = label;
+        used |= 1u << label;
+    }
+    return;
+}
+
+int DistanceTable::Blank( const int* labels) const {
+    return int( std::find( labels, labels + free_cells_.size(), blank_label_) - labels);
+}
+
+bool DistanceTable::Build( const Position& goal, const std::string& file_name, size_t memory, std::string& error_msg,
+                           const BuildProgress& progress) {
+    error_msg = "";
+    Clear();
+    if ( !Index( goal) ) {
+        throw std::invalid_argument( "goal");
+    }
+    int cells = goal.Height() * goal.Width();
+    size_t header = HeaderSize( cells);
+    size_t bytes = size_t( (states_ + 3) / 4);
+    FILE* file = fopen( file_name.c_str(), "wb");
+    if ( !file ) {
+        error_msg = "Can't open " + file_name;
+        return false;
+    }
+    bool ok = (fwrite( MAGIC, sizeof( MAGIC), 1, file) == 1) && Write( file, VERSION)
+        && Write( file, uint32_t( goal.Height())) && Write( file, uint32_t( goal.Width()));
+    for ( int cell = 0; ok && (cell < cells); ++cell ) {
+        ok = Write( file, int32_t( goal.GetField( cell)));
+    }
+    ok = ok && Write( file, states_) && Write( file, uint32_t( 0));
+    ok = (fclose( file) == 0) && ok && (truncate( file_name.c_str(), off_t( header + bytes)) == 0);
+    int descriptor = ok ? open( file_name.c_str(), O_RDWR) : -1;
+    if ( descriptor >= 0 ) {
+        mapping_size_ = header + bytes;
+        mapping_ = mmap( 0, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+        close( descriptor);
+        if ( mapping_ == MAP_FAILED ) {
+            mapping_ = 0;
+        }
+    }
+    if ( !mapping_ ) {
+        Clear();
+        error_msg = "Can't write " + file_name;
+        return false;
+    }
+    unsigned char* bits = static_cast<unsigned char*>( mapping_) + header;
+    std::memset( bits, 0xFF, bytes);
+    bits_ = bits;
+    auto set = [bits]( uint32_t rank, int value) {
+        unsigned char& entry = bits[rank >> 2];
+        entry = (unsigned char)( (entry & ~(3 << ((rank & 3) * 2))) | (value << ((rank & 3) * 2)));
+    };
+
+    // Поиск в ширину от цели. Фронт глубины depth лежит в файле номеров по
+    // возрастанию. Соседи его позиций, еще не получившие расстояния, копятся
+    // в буфере; заполненный буфер сортируется и пишется отдельным файлом.
+    // Слияние этих файлов дает соседей по возрастанию номеров без повторов:
+    // таблица обходится последовательно, а новые позиции образуют следующий фронт.
+    std::string frontier_names[2] = {file_name + ".frontier0", file_name + ".frontier1"};
+    size_t capacity = std::max( memory / sizeof( uint32_t), size_t( 1024));
+    std::vector<uint32_t> buffer;
+    std::vector<std::string> run_names;
+    int labels[MAX_FREE_CELLS];
+    set( goal_rank_, 0);
+    file = fopen( frontier_names[0].c_str(), "wb");
+    ok = file && Write( file, goal_rank_);
+    ok = file && (fclose( file) == 0) && ok;
+    uint64_t layer = 1;
+    int depth = 0;
+    for ( ; ok && layer; ++depth ) {
+        if ( progress ) {
+            progress( depth, layer);
+        }
+        max_depth_ = depth;
+        auto flush = [&]() {
+            std::sort( buffer.begin(), buffer.end());
+            buffer.erase( std::unique( buffer.begin(), buffer.end()), buffer.end());
+            char suffix[32];
+            snprintf( suffix, sizeof( suffix), ".run%u", unsigned( run_names.size()));
+            run_names.push_back( file_name + suffix);
+            FILE* run = fopen( run_names.back().c_str(), "wb");
+            ok = run && (fwrite( buffer.data(), sizeof( uint32_t), buffer.size(), run) == buffer.size());
+            ok = run && (fclose( run) == 0) && ok;
+            buffer.clear();
+        };
+        FILE* current = fopen( frontier_names[depth % 2].c_str(), "rb");
+        ok = (current != 0);
+        for ( uint32_t state; ok && (fread( &state, sizeof( state), 1, current) == 1); ) {
+            Unrank( state, labels);
+            int blank = Blank( labels);
+            int cell = free_cells_[blank];
+            for ( int i = 0; i < neighbors_.Count( cell); ++i ) {
+                int neighbor = free_index_[neighbors_.Neighbors( cell)[i]];
+                std::swap( labels[blank], labels[neighbor]);
+                uint32_t rank = Rank( labels);
+                if ( Get( rank) == UNKNOWN ) {
+                    buffer.push_back( rank);
+                }
+                std::swap( labels[blank], labels[neighbor]);
+            }
+            if ( buffer.size() + 4 > capacity ) {
+                flush();
+            }
+        }
+        if ( current ) {
+            fclose( current);
+        }
+        remove( frontier_names[depth % 2].c_str());
+        FILE* next = ok ? fopen( frontier_names[(depth + 1) % 2].c_str(), "wb") : 0;
+        ok = (next != 0);
+        layer = 0;
+        int value = (depth + 1) % 3;
+        uint32_t last = 0;
+        auto visit = [&]( uint32_t rank) {
+            if ( Get( rank) == UNKNOWN ) {
+                set( rank, value);
+                ok = ok && Write( next, rank);
+                ++layer;
+            }
+        };
+        if ( ok && run_names.empty() ) {
+            // Фронт уместился в буфер.
+            std::sort( buffer.begin(), buffer.end());
+            for ( size_t index = 0; index < buffer.size(); ++index ) {
+                visit( buffer[index]);
+            }
+            buffer.clear();
+        } else if ( ok ) {
+            if ( !buffer.empty() ) {
+                flush();
+            }
+            std::vector<Run> runs( run_names.size());
+            std::priority_queue<Run*, std::vector<Run*>, RunGreater> heads;
+            for ( size_t index = 0; index < runs.size(); ++index ) {
+                runs[index].file = fopen( run_names[index].c_str(), "rb");
+                ok = ok && runs[index].file;
+                if ( runs[index].file && runs[index].Next() ) {
+                    heads.push( &runs[index]);
+                }
+            }
+            for ( bool first = true; ok && !heads.empty(); first = false ) {
+                Run* run = heads.top();
+                heads.pop();
+                if ( first || (run->value != last) ) {
+                    visit( run->value);
+                    last = run->value;
+                }
+                if ( run->Next() ) {
+                    heads.push( run);
+                }
+            }
+            for ( size_t index = 0; index < runs.size(); ++index ) {
+                if ( runs[index].file ) {
+                    fclose( runs[index].file);
+                }
+                remove( run_names[index].c_str());
+            }
+            run_names.clear();
+        }
+        ok = next && (fclose( next) == 0) && ok;
+    }
+    remove( frontier_names[0].c_str());
+    remove( frontier_names[1].c_str());
+    if ( ok ) {
+        // Наибольшая глубина - последнее поле заголовка.
+        uint32_t max_depth = uint32_t( max_depth_);
+        std::memcpy( bits - sizeof( max_depth), &max_depth, sizeof( max_depth));
+        ok = (msync( mapping_, mapping_size_, MS_SYNC) == 0);
+    }
+    Clear();
+    if ( !ok ) {
+        error_msg = "Can't write " + file_name;
+        return false;
+    }
+    return Load( file_name, error_msg);
+}
+
+bool DistanceTable::Load( const std::string& file_name, std::string& error_msg) {
+    error_msg = "";
+    Clear();
+    int file = open( file_name.c_str(), O_RDONLY);
+    if ( file < 0 ) {
+        error_msg = "Can't open " + file_name;
+        return false;
+    }
+    struct stat info;
+    if ( (fstat( file, &info) != 0) || (info.st_size < off_t( sizeof( MAGIC))) ) {
+        close( file);
+        error_msg = "Bad distance table " + file_name;
+        return false;
+    }
+    mapping_size_ = size_t( info.st_size);
+    mapping_ = mmap( 0, mapping_size_, PROT_READ, MAP_SHARED, file, 0);
+    close( file);
+    if ( mapping_ == MAP_FAILED ) {
+        mapping_ = 0;
+        error_msg = "Can't map " + file_name;
+        return false;
+    }
+    const unsigned char* data = static_cast<const unsigned char*>( mapping_);
+    const unsigned char* end = data + mapping_size_;
+    uint32_t version = 0, height = 0, width = 0, max_depth = 0;
+    uint64_t states = 0;
+    bool ok = !std::memcmp( data, MAGIC, sizeof( MAGIC));
+    data += sizeof( MAGIC);
+    ok = ok && Read( data, end, version) && (version == VERSION)
+        && Read( data, end, height) && Read( data, end, width)
+        && (height > 0) && (width > 0) && (height <= uint32_t( MAX_CELLS) / width);
+    if ( ok ) {
+        vector<int> cells( height * width);
+        for ( size_t cell = 0; ok && (cell < cells.size()); ++cell ) {
+            int32_t value = 0;
+            ok = Read( data, end, value) && (value >= Position::STONE);
+            cells[cell] = value;
+        }
+        ok = ok && Index( Position( int( height), int( width), cells));
+    }
+    ok = ok && Read( data, end, states) && (states == states_) && Read( data, end, max_depth)
+        && (uint64_t( end - data) >= (states_ + 3) / 4);
+    if ( !ok ) {
+        Clear();
+        error_msg = "Bad distance table " + file_name;
+        return false;
+    }
+    max_depth_ = int( max_depth);
+    bits_ = data;
+    return true;
+}
+
+bool DistanceTable::Matches( const Position& goal) const {
+    return bits_ && (goal == goal_);
+}
+
+int DistanceTable::Walk( const Position& position, Solution* solution) const {
+    int labels[MAX_FREE_CELLS];
+    if ( !bits_ || !Labels( position, labels) ) {
+        return -1;
+    }
+    uint32_t rank = Rank( labels);
+    int depth = Get( rank);
+    if ( depth == UNKNOWN ) {
+        return -1;
+    }
+    int blank = Blank( labels);
+    int length = 0;
+    while ( rank != goal_rank_ ) {
+        // Сосед ближе к цели на один ход имеет остаток на единицу меньше.
+        int closer = (depth + 2) % 3;
+        int cell = free_cells_[blank];
+        int next = -1;
+        for ( int i = 0; (next < 0) && (i < neighbors_.Count( cell)); ++i ) {
+            int neighbor = free_index_[neighbors_.Neighbors( cell)[i]];
+            std::swap( labels[blank], labels[neighbor]);
+            uint32_t neighbor_rank = Rank( labels);
+            if ( Get( neighbor_rank) == closer ) {
+                next = neighbor;
+                rank = neighbor_rank;
+            } else {
+                std::swap( labels[blank], labels[neighbor]);
+            }
+        }
+        if ( (next < 0) || (length > max_depth_) ) {
+            // Таблица испорчена.
+            return -1;
+        }
+        if ( solution ) {
+            solution->Append( Position::Move( free_cells_[next], cell));
+        }
+        blank = next;
+        depth = closer;
+        ++length;
+    }
+    return length;
+}
+
+int DistanceTable::Distance( const Position& position) const {
+    return Walk( position, 0);
+}
+
+Solution DistanceTable::Path( const Position& position) const {
+    Solution solution( position);
+    if ( Walk( position, &solution) < 0 ) {
+        return Solution();
+    }
+    return solution;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef _DISTANCE_TABLE_H_
+#define _DISTANCE_TABLE_H_
+
+#include <stdint.h>
+#include <string>
+#include <functional>
+#include "position.h"
+#include "solution.h"
+
+// Точные расстояния до цели для всех позиций небольшого поля (до
+// MAX_FREE_CELLS клеток без камней, одно пустое место, различные фишки).
+// Позиция нумеруется номером перестановки фишек и пустого места по клеткам
+// без камней; для каждого номера хранится 2 бита - расстояние по модулю 3
+// или UNKNOWN для недостижимых. Соседние позиции отличаются по расстоянию
+// ровно на 1, поэтому кратчайший путь восстанавливается за O(длины) просмотров:
+// на каждом шаге выбирается сосед с остатком на единицу меньше.
+// Таблица строится поиском в ширину от цели прямо в файле, отображенном в
+// память; фронты хранятся на диске отсортированными файлами номеров и
+// обрабатываются кусками не больше заданного объема памяти, поэтому
+// построение не требует памяти на все позиции. Запросы только читают
+// отображение и могут выполняться из нескольких потоков.
+class DistanceTable {
+public:
+    // Вызывается после каждого слоя: глубина и число позиций на ней.
+    typedef std::function<void( int depth, uint64_t count)> BuildProgress;
+    DistanceTable();
+    ~DistanceTable();
+    // Строит таблицу для goal в файл file_name и загружает ее. memory - память
+    // на буфер номеров фронта в байтах. Временные файлы фронтов создаются
+    // рядом с file_name. Неподходящая цель - std::invalid_argument, ошибки
+    // ввода-вывода - false и error_msg.
+    bool Build( const Position& goal, const std::string& file_name, size_t memory, std::string& error_msg,
+                const BuildProgress& progress = BuildProgress());
+    // Отображает файл в память.
+    bool Load( const std::string& file_name, std::string& error_msg);
+    // true, если таблица загружена для цели goal.
+    bool Matches( const Position& goal) const;
+    const Position& Goal() const {return goal_;}
+    // Число номеров перестановок и наибольшее расстояние.
+    uint64_t States() const {return states_;}
+    int MaxDepth() const {return max_depth_;}
+    // Расстояние до цели, -1 если цель недостижима или позиция не подходит к таблице.
+    int Distance( const Position& position) const;
+    // Кратчайший путь до цели; пустое решение, если Distance == -1.
+    Solution Path( const Position& position) const;
+    const static uint32_t VERSION;
+    enum { MAX_FREE_CELLS = 12 };
+private:
+    DistanceTable( const DistanceTable&);
+    DistanceTable& operator=( const DistanceTable&);
+    enum { UNKNOWN = 3 };
+    void Clear();
+    // Готовит нумерацию по цели; false, если цель не подходит.
+    bool Index( const Position& goal);
+    // Метки значений по свободным клеткам; false, если позиция не подходит к таблице.
+    bool Labels( const Position& position, int* labels) const;
+    uint32_t Rank( const int* labels) const;
+    void Unrank( uint32_t rank, int* labels) const;
+    // Свободная клетка пустого места.
+    int Blank( const int* labels) const;
+    int Get( uint32_t rank) const {return (bits_[rank >> 2] >> ((rank & 3) * 2)) & 3;}
+    // Проход до цели, возвращает Distance; solution получает ходы, если не 0.
+    int Walk( const Position& position, Solution* solution) const;
+    Position goal_;
+    NeighborTable neighbors_;
+    // Клетки без камней и номер свободной клетки для каждой клетки поля (-1 - камень).
+    std::vector<int> free_cells_;
+    std::vector<int> free_index_;
+    // Метка значения клетки: место значения среди отсортированных значений цели.
+    std::vector<int> label_;
+    int blank_label_;
+    uint32_t goal_rank_;
+    uint64_t states_;
+    int max_depth_;
+    const unsigned char* bits_;
+    void* mapping_;
+    size_t mapping_size_;
+};
+
+#endif /* _DISTANCE_TABLE_H_ */
@@ -0,0 +1,383 @@
+#include "hda_search.h"
+#include "reachability.h"
+#include <thread>
+#include <stdexcept>
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+// Размер пачки сообщений одному потоку и число раскрытий между
+// проверками очереди и отправкой неполных пачек.
+const size_t BATCH_SIZE = 64;
+const int EXPANSION_CHUNK = 64;
+// Раз в столько раскрытий поток сверяется с общим счетчиком и временем.
+const long long REPORT_PERIOD = 1024;
+
+} // namespace
+
+struct HDAStarSearcher::Worker {
+    Worker() : pool( arena), opened_set( arena), inbox( 0), frontier( INT_MAX), bytes( 0), nodes( 0) {}
+    VertexArena arena;
+    VertexPool pool;
+    OpenedSet opened_set;
+    std::unique_ptr<Heuristic> heuristic;
+    // Стек пачек, добавляемых другими потоками; забирается целиком.
+    std::atomic<Batch*> inbox;
+    // Неотправленные пачки для каждого потока.
+    std::vector<Batch*> outbox;
+    // Оценка последней извлеченной вершины, INT_MAX при пустой очереди.
+    std::atomic<int> frontier;
+    // Память арены и пула, обновляется раз в REPORT_PERIOD раскрытий.
+    std::atomic<size_t> bytes;
+    long long nodes;
+    SideStats stats;
+};
+
+HDAStarSearcher::HDAStarSearcher()
+    : reuse_arena_( false), heuristic_( 0), time_limit_( 0), control_( 0), nodes_( 0), limit_( 0), threads_( 0),
+      active_( 0), stop_( NOT_STOPPED), shared_nodes_( 0), incumbent_( INT_MAX), incumbent_end_( NO_NODE) {
+    SetThreads( std::max( 1, std::min<int>( MAX_THREADS, std::thread::hardware_concurrency())));
+}
+
+HDAStarSearcher::~HDAStarSearcher() {
+    Reset();
+}
+
+void HDAStarSearcher::SetThreads( int threads) {
+    if ( (threads < 1) || (threads > MAX_THREADS) ) {
+        throw std::invalid_argument( "threads");
+    }
+    threads_ = threads;
+    return;
+}
+
+int HDAStarSearcher::Owner( const Position& position) const {
+    return int( (position.Hash() >> 32) % uint64_t( threads_));
+}
+
+void HDAStarSearcher::Reset() {
+    for ( size_t worker = 0; worker < workers_.size(); ++worker ) {
+        Worker& current = *workers_[worker];
+        Batch* batch = current.inbox.exchange( 0);
+        while ( batch ) {
+            Batch* next = batch->next;
+            delete batch;
+            batch = next;
+        }
+        for ( size_t target = 0; target < current.outbox.size(); ++target ) {
+            delete current.outbox[target];
+        }
+        current.outbox.clear();
+        current.heuristic.reset();
+        if ( reuse_arena_ ) {
+            current.opened_set.Clear();
+            current.pool.Clear();
+            current.arena.Clear();
+        } else {
+            current.opened_set.Release();
+            current.pool.Release();
+            current.arena.Release();
+        }
+    }
+    return;
+}
+
+bool HDAStarSearcher::Receive( int worker, const Message& message) {
+    Worker& current = *workers_[worker];
+    NodeIndex vertex;
+    {
+        ProfileScope scope( current.stats.lookup_seconds);
+        vertex = current.pool.Find( message.position);
+    }
+    if ( vertex == NO_NODE ) {
+        if ( current.arena.Size() >= size_t( MAX_VERTICES) ) {
+            return false;
+        }
+        vertex = current.arena.Allocate( message.position, message.cost, message.h, message.h + message.cost, message.parent);
+        current.pool.Insert( vertex);
+        current.opened_set.Insert( vertex);
+        return true;
+    }
+    ++current.stats.duplicates;
+    if ( current.arena[vertex].cost > message.cost ) {
+        ++current.stats.reopened;
+        // Порядок раскрытия не глобальный, поэтому закрытая вершина может
+        // получить путь короче и должна быть раскрыта заново.
+        current.arena[vertex].parent = message.parent;
+        if ( current.opened_set.Contains( vertex) ) {
+            current.opened_set.DecreaseKey( vertex, message.cost);
+        } else {
+            current.arena[vertex].heuristic += message.cost - current.arena[vertex].cost;
+            current.arena[vertex].cost = message.cost;
+            current.opened_set.Insert( vertex);
+        }
+    }
+    return true;
+}
+
+void HDAStarSearcher::Send( int worker, const Message& message) {
+    int owner = Owner( message.position);
+    Worker& current = *workers_[worker];
+    Batch*& batch = current.outbox[owner];
+    if ( !batch ) {
+        batch = new Batch();
+        batch->messages.reserve( BATCH_SIZE);
+    }
+    batch->messages.push_back( message);
+    if ( batch->messages.size() >= BATCH_SIZE ) {
+        Flush( worker);
+    }
+    return;
+}
+
+void HDAStarSearcher::Flush( int worker) {
+    Worker& current = *workers_[worker];
+    for ( int owner = 0; owner < threads_; ++owner ) {
+        Batch* batch = current.outbox[owner];
+        if ( !batch ) {
+            continue;
+        }
+        current.outbox[owner] = 0;
+        // Пачка учитывается до того, как станет видна получателю.
+        active_.fetch_add( 1);
+        std::atomic<Batch*>& inbox = workers_[owner]->inbox;
+        batch->next = inbox.load( std::memory_order_relaxed);
+        while ( !inbox.compare_exchange_weak( batch->next, batch, std::memory_order_release, std::memory_order_relaxed) ) {
+        }
+    }
+    return;
+}
+
+void HDAStarSearcher::Run( int worker) {
+    Worker& current = *workers_[worker];
+    Position::MoveList moves;
+    long long unreported = 0;
+    bool idle = false;
+    while ( stop_.load( std::memory_order_relaxed) == NOT_STOPPED ) {
+        Batch* batch = current.inbox.exchange( 0, std::memory_order_acquire);
+        if ( batch && idle ) {
+            active_.fetch_add( 1);
+            idle = false;
+        }
+        bool overflow = false;
+        while ( batch ) {
+            for ( size_t index = 0; index < batch->messages.size(); ++index ) {
+                overflow = overflow || !Receive( worker, batch->messages[index]);
+            }
+            Batch* next = batch->next;
+            delete batch;
+            batch = next;
+            active_.fetch_sub( 1);
+        }
+        if ( overflow ) {
+            stop_ = MEMORY_LIMIT;
+            break;
+        }
+        // Поток, ушедший по оценке дальше других (или дальше вершин, отправленных
+        // им самим и еще не полученных), прерывает порцию и уступает процессор:
+        // иначе он раскрывает вершины, которые A* раскрыл бы много позже.
+        int lowest = INT_MAX;
+        for ( int other = 0; other < threads_; ++other ) {
+            if ( other != worker ) {
+                lowest = std::min( lowest, workers_[other]->frontier.load( std::memory_order_relaxed));
+            }
+        }
+        bool behind = false;
+        int expanded = 0;
+        while ( !current.opened_set.Empty() && (expanded < EXPANSION_CHUNK) ) {
+            NodeIndex vertex = current.opened_set.ExtractMin();
+            // Граница только уменьшается, так что отброшенная вершина не понадобится,
+            // пока не придет путь к ней короче.
+            if ( current.arena[vertex].heuristic >= incumbent_.load( std::memory_order_relaxed) ) {
+                continue;
+            }
+            current.frontier.store( current.arena[vertex].heuristic, std::memory_order_relaxed);
+            if ( current.arena[vertex].heuristic > lowest ) {
+                current.opened_set.Insert( vertex);
+                behind = true;
+                break;
+            }
+            ++expanded;
+            ++current.nodes;
+            if ( ++unreported == REPORT_PERIOD ) {
+                unreported = 0;
+                long long shared = shared_nodes_.fetch_add( REPORT_PERIOD) + REPORT_PERIOD;
+                if ( shared >= limit_ ) {
+                    stop_ = NODE_LIMIT;
+                }
+                if ( !worker && progress_ ) {
+                    SearchStats progress;
+                    progress.sides[SearchStats::SOURCE].expanded = shared;
+                    progress.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+                    progress_( progress);
+                }
+                current.bytes.store( current.arena.Capacity() + current.pool.Capacity(), std::memory_order_relaxed);
+                size_t bytes = 0;
+                for ( int other = 0; other < threads_; ++other ) {
+                    bytes += workers_[other]->bytes.load( std::memory_order_relaxed);
+                }
+                StopReason reason = budget_.Check( bytes);
+                if ( reason != NOT_STOPPED ) {
+                    stop_ = reason;
+                }
+            }
+            Position position = current.arena[vertex].position;
+            int cost = current.arena[vertex].cost;
+            if ( position == goal_ ) {
+                std::lock_guard<std::mutex> lock( incumbent_mutex_);
+                if ( cost < incumbent_ ) {
+                    incumbent_ = cost;
+                    incumbent_end_ = Ref( worker, vertex);
+                }
+                continue;
+            }
+            int h = current.arena[vertex].h;
+            {
+                ProfileScope scope( current.stats.move_generation_seconds);
+                position.GetPossibleMoves( neighbors_, moves);
+            }
+            current.stats.generated += moves.Size();
+            current.stats.heuristic_evaluations += moves.Size();
+            for ( int index = 0; index < moves.Size(); ++index ) {
+                const Position::Move& move = moves[index];
+                position.Swap( move.from, move.to);
+                Message message;
+                {
+                    ProfileScope scope( current.stats.heuristic_seconds);
+                    message.h = current.heuristic->UpdateDistance( position, h, move.from, move.to);
+                }
+                message.cost = cost + 1;
+                if ( message.cost + message.h < incumbent_.load( std::memory_order_relaxed) ) {
+                    message.position = position;
+                    message.parent = Ref( worker, vertex);
+                    if ( Owner( position) == worker ) {
+                        overflow = overflow || !Receive( worker, message);
+                    } else {
+                        Send( worker, message);
+                        lowest = std::min( lowest, message.cost + message.h);
+                    }
+                }
+                position.Swap( move.from, move.to);
+            }
+            current.stats.peak_opened = std::max( current.stats.peak_opened, current.opened_set.Size());
+        }
+        if ( overflow ) {
+            stop_ = MEMORY_LIMIT;
+            break;
+        }
+        Flush( worker);
+        if ( behind ) {
+            std::this_thread::yield();
+        }
+        if ( current.opened_set.Empty() ) {
+            current.frontier.store( INT_MAX, std::memory_order_relaxed);
+            if ( !idle ) {
+                idle = true;
+                active_.fetch_sub( 1);
+            }
+            if ( !active_.load() ) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+    return;
+}
+
+std::vector<Position> HDAStarSearcher::Search( const Position& source, const Position& goal, long long limit, std::string& error_msg) {
+    error_msg = "";
+    std::vector<Position> way;
+    nodes_ = 0;
+    stats_.Clear();
+    partial_.clear();
+    if ( !CheckReachability( source, goal, error_msg) ) {
+        return way;
+    }
+    while ( int( workers_.size()) < threads_ ) {
+        workers_.push_back( std::unique_ptr<Worker>( new Worker()));
+    }
+    for ( int worker = 0; worker < threads_; ++worker ) {
+        workers_[worker]->heuristic = PrepareHeuristic( heuristic_, goal);
+        workers_[worker]->outbox.assign( threads_, 0);
+        workers_[worker]->nodes = 0;
+        workers_[worker]->stats = SideStats();
+        workers_[worker]->frontier = INT_MAX;
+        workers_[worker]->bytes = 0;
+    }
+    goal_ = goal;
+    neighbors_ = NeighborTable( source);
+    start_ = std::chrono::steady_clock::now();
+    budget_.Start( control_, limit, time_limit_);
+    limit_ = budget_.NodeLimit();
+    stop_ = NOT_STOPPED;
+    shared_nodes_ = 0;
+    incumbent_ = INT_MAX;
+    incumbent_end_ = NO_NODE;
+    active_ = threads_;
+
+    Message root;
+    root.position = source;
+    root.cost = 0;
+    root.h = workers_[0]->heuristic->Distance( source);
+    root.parent = NO_NODE;
+    Receive( Owner( source), root);
+    std::vector<std::thread> threads;
+    for ( int worker = 1; worker < threads_; ++worker ) {
+        threads.push_back( std::thread( &HDAStarSearcher::Run, this, worker));
+    }
+    Run( 0);
+    for ( size_t thread = 0; thread < threads.size(); ++thread ) {
+        threads[thread].join();
+    }
+
+    nodes_ = 0;
+    for ( int worker = 0; worker < threads_; ++worker ) {
+        Worker& current = *workers_[worker];
+        nodes_ += current.nodes;
+        current.stats.expanded = current.nodes;
+        current.stats.closed = current.pool.Size() - current.opened_set.Size();
+        stats_.sides[SearchStats::SOURCE].Add( current.stats);
+    }
+    // Плюс оценка начальной позиции.
+    ++stats_.sides[SearchStats::SOURCE].heuristic_evaluations;
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    if ( incumbent_end_ != NO_NODE ) {
+        for ( NodeIndex ref = incumbent_end_; ref != NO_NODE; ) {
+            const Vertex& vertex = workers_[RefWorker( ref)]->arena[RefIndex( ref)];
+            way.push_back( vertex.position);
+            ref = vertex.parent;
+        }
+        std::reverse( way.begin(), way.end());
+    } else if ( stop_ != NOT_STOPPED ) {
+        error_msg = StopMessage( StopReason( stop_.load()));
+        // Лучшая вершина очереди среди всех потоков.
+        int best_worker = -1;
+        NodeIndex best = NO_NODE;
+        for ( int worker = 0; worker < threads_; ++worker ) {
+            const VertexArena& arena = workers_[worker]->arena;
+            NodeIndex vertex = BestOpened( arena);
+            if ( vertex == NO_NODE ) {
+                continue;
+            }
+            if ( best != NO_NODE ) {
+                const Vertex& current = workers_[best_worker]->arena[best];
+                if ( (arena[vertex].h > current.h) || ((arena[vertex].h == current.h) && (arena[vertex].cost >= current.cost)) ) {
+                    continue;
+                }
+            }
+            best_worker = worker;
+            best = vertex;
+        }
+        for ( NodeIndex ref = (best == NO_NODE) ? NO_NODE : Ref( best_worker, best); ref != NO_NODE; ) {
+            const Vertex& vertex = workers_[RefWorker( ref)]->arena[RefIndex( ref)];
+            partial_.push_back( vertex.position);
+            ref = vertex.parent;
+        }
+        std::reverse( partial_.begin(), partial_.end());
+    } else {
+        error_msg = "No solution";
+    }
+    Reset();
+    return way;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#ifndef _HDA_SEARCH_H_
+#define _HDA_SEARCH_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include "position.h"
+#include "heuristic.h"
+#include "search.h"
+#include "search_stats.h"
+#include "search_control.h"
+
+// Параллельный A* с распределением позиций по потокам по хешу (HDA*).
+// Каждый поток владеет своими VertexArena, VertexPool и OpenedSet; порожденные
+// позиции чужих потоков копятся в пачки и передаются владельцу через его
+// очередь без блокировок (много писателей, один читатель). Найденное решение
+// служит верхней границей: вершины с оценкой не меньше нее отбрасываются.
+// Поиск завершается, когда все потоки простаивают и в очередях нет пачек;
+// найденное к этому моменту решение оптимально при допустимой оценке.
+class HDAStarSearcher {
+public:
+    HDAStarSearcher();
+    ~HDAStarSearcher();
+    // Число потоков, от 1 до MAX_THREADS; по умолчанию - число ядер, но не
+    // больше MAX_THREADS.
+    void SetThreads( int threads);
+    void SetReuseArena( bool reuse) {reuse_arena_ = reuse;}
+    void SetHeuristic( const Heuristic* heuristic) {heuristic_ = heuristic;}
+    // Ограничение времени одного вызова Search в секундах, 0 - без ограничения.
+    void SetTimeLimit( double seconds) {time_limit_ = seconds;}
+    // Внешние ограничения и отмена, 0 - нет. Память учитывает арены и пулы всех потоков.
+    void SetControl( const SearchControl* control) {control_ = control;}
+    long long NodesExpanded() const {return nodes_;}
+    // Статистика последнего вызова Search, сумма по потокам; пики размеров
+    // очереди и пула суммируются и потому дают оценку сверху.
+    const SearchStats& Stats() const {return stats_;}
+    // Вызывается из вызвавшего Search потока раз в 1024 раскрытых им вершины;
+    // до остановки заполнены только общее число раскрытий и время.
+    void SetProgress( const ProgressCallback& progress) {progress_ = progress;}
+    // limit - ограничение на число раскрытых вершин. Если поиск остановлен
+    // ограничением после того, как решение уже найдено, возвращается лучшее
+    // найденное (возможно, не кратчайшее).
+    std::vector<Position> Search( const Position& source, const Position& goal, long long limit, std::string& error_msg);
+    // Путь до вершины очереди с наименьшей оценкой среди всех потоков, если
+    // последний Search прерван без найденного решения; иначе пуст.
+    const std::vector<Position>& BestPartial() const {return partial_;}
+    enum { MAX_THREADS = 64 };
+private:
+    HDAStarSearcher( const HDAStarSearcher&);
+    HDAStarSearcher& operator=( const HDAStarSearcher&);
+    // Ссылка на вершину любого потока: номер потока в старших битах NodeIndex.
+    // Поток, которому не хватило MAX_VERTICES вершин, останавливает поиск
+    // с MEMORY_LIMIT.
+    enum { INDEX_BITS = 26, MAX_VERTICES = (1 << INDEX_BITS) - 1 };
+    static NodeIndex Ref( int worker, NodeIndex index) {return (NodeIndex( worker) << INDEX_BITS) | index;}
+    static int RefWorker( NodeIndex ref) {return int( ref >> INDEX_BITS);}
+    static NodeIndex RefIndex( NodeIndex ref) {return ref & MAX_VERTICES;}
+    struct Message {
+        Position position;
+        int cost;
+        int h;
+        NodeIndex parent;
+    };
+    struct Batch {
+        Batch* next;
+        std::vector<Message> messages;
+    };
+    struct Worker;
+    int Owner( const Position& position) const;
+    void Run( int worker);
+    // Добавляет вершину из сообщения владельцу worker. false при переполнении арены.
+    bool Receive( int worker, const Message& message);
+    void Send( int worker, const Message& message);
+    // Передает накопленные пачки worker; в active_ учитывается каждая пачка.
+    void Flush( int worker);
+    void Reset();
+    bool reuse_arena_;
+    const Heuristic* heuristic_;
+    double time_limit_;
+    const SearchControl* control_;
+    SearchBudget budget_;
+    std::vector<Position> partial_;
+    long long nodes_;
+    SearchStats stats_;
+    ProgressCallback progress_;
+    std::chrono::steady_clock::time_point start_;
+    long long limit_;
+    Position goal_;
+    NeighborTable neighbors_;
+    std::vector< std::unique_ptr<Worker> > workers_;
+    int threads_;
+    // Число работающих потоков плюс число непрочитанных пачек; 0 - поиск завершен.
+    std::atomic<long long> active_;
+    // StopReason; NOT_STOPPED - поиск продолжается.
+    std::atomic<int> stop_;
+    std::atomic<long long> shared_nodes_;
+    // Стоимость лучшего найденного решения и ссылка на его конечную вершину.
+    std::atomic<int> incumbent_;
+    NodeIndex incumbent_end_;
+    std::mutex incumbent_mutex_;
+};
+
+#endif /* _HDA_SEARCH_H_ */
@@ -0,0 +1,382 @@
+#include "heuristic.h"
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <limits>
+
+namespace {
+
+const int MAX_LINE = 64;
+
+// Значение, сдвинутая фишка, ее клетка до хода и после хода.
+void MovedTile( const Position& position, int move_from, int move_to, int& value, int& old_cell, int& new_cell) {
+    if ( position.GetField( move_to) != Position::BLANK ) {
+        value = position.GetField( move_to);
+        old_cell = move_from;
+        new_cell = move_to;
+    } else {
+        value = position.GetField( move_from);
+        old_cell = move_to;
+        new_cell = move_from;
+    }
+    return;
+}
+
+// Для различных фишек цели - клетка каждой фишки; false, если фишки повторяются.
+bool GoalCells( const Position& goal, std::vector<int>& goal_cell) {
+    goal_cell.clear();
+    for ( int cell = 0; cell < goal.Height() * goal.Width(); ++cell ) {
+        int value = goal.GetField( cell);
+        if ( (value == Position::BLANK) || (value == Position::STONE) ) {
+            continue;
+        }
+        if ( size_t( value) >= goal_cell.size() ) {
+            goal_cell.resize( value + 1, -1);
+        }
+        if ( goal_cell[value] != -1 ) {
+            return false;
+        }
+        goal_cell[value] = cell;
+    }
+    return true;
+}
+
+int BitWidth( int value) {
+    int result = 0;
+    for ( ; value; value >>= 1 ) {
+        ++result;
+    }
+    return result;
+}
+
+} // namespace
+
+std::unique_ptr<Heuristic> PrepareHeuristic( const Heuristic* prototype, const Position& goal) {
+    std::unique_ptr<Heuristic> result;
+    if ( prototype ) {
+        result.reset( prototype->Clone());
+        if ( !result->Prepare( goal) ) {
+            result.reset();
+        }
+    }
+    if ( !result ) {
+        result.reset( new ManhattanHeuristic());
+        result->Prepare( goal);
+    }
+    return result;
+}
+
+const int ManhattanHeuristic::MAX_TABLE_VALUE = 1 << 12;
+
+bool ManhattanHeuristic::Prepare( const Position& goal) {
+    goal_ = goal;
+    cells_ = goal.Height() * goal.Width();
+    table_.clear();
+    int max_value = 0;
+    for ( int cell = 0; cell < cells_; ++cell ) {
+        max_value = std::max( max_value, goal.GetField( cell));
+    }
+    if ( max_value > MAX_TABLE_VALUE ) {
+        return true;
+    }
+    int width = goal.Width();
+    // Пустые места и значения, которых нет в цели, оцениваются нулем.
+    table_.assign( (max_value + 1) * cells_, std::numeric_limits<int>::max());
+    std::fill( table_.begin(), table_.begin() + cells_, 0);
+    for ( int target = 0; target < cells_; ++target ) {
+        int value = goal.GetField( target);
+        if ( (value == Position::BLANK) || (value == Position::STONE) ) {
+            continue;
+        }
+        for ( int cell = 0; cell < cells_; ++cell ) {
+            int& entry = table_[value * cells_ + cell];
+            entry = std::min( entry, abs( cell / width - target / width) + abs( cell % width - target % width));
+        }
+    }
+    std::replace( table_.begin(), table_.end(), std::numeric_limits<int>::max(), 0);
+    return true;
+}
+
+int ManhattanHeuristic::Distance( const Position& position) const {
+    if ( table_.empty() ) {
+        return position.Distance( goal_);
+    }
+    int result = 0;
+    for ( int cell = 0; cell < cells_; ++cell ) {
+        int value = position.GetField( cell);
+        if ( value > 0 ) {
+            result += table_[value * cells_ + cell];
+        }
+    }
+    return result;
+}
+
+int ManhattanHeuristic::UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const {
+    if ( table_.empty() ) {
+        return position.UpdateDistance( goal_, old_distance, move_from, move_to);
+    }
+    int value, old_cell, new_cell;
+    MovedTile( position, move_from, move_to, value, old_cell, new_cell);
+    const int* distance = &table_[value * cells_];
+    return old_distance - distance[old_cell] + distance[new_cell];
+}
+
+Heuristic* ManhattanHeuristic::Clone() const {
+    return new ManhattanHeuristic( *this);
+}
+
+PatternDatabaseHeuristic::PatternDatabaseHeuristic( const PatternDatabase& database)
+    : database_( database) {
+}
+
+bool PatternDatabaseHeuristic::Prepare( const Position& goal) {
+    return database_.Matches( goal);
+}
+
+int PatternDatabaseHeuristic::Distance( const Position& position) const {
+    return database_.Distance( position);
+}
+
+int PatternDatabaseHeuristic::UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const {
+    return database_.UpdateDistance( position, old_distance, move_from, move_to);
+}
+
+Heuristic* PatternDatabaseHeuristic::Clone() const {
+    return new PatternDatabaseHeuristic( *this);
+}
+
+bool LinearConflictHeuristic::Prepare( const Position& goal) {
+    height_ = goal.Height();
+    width_ = goal.Width();
+    return (height_ <= MAX_LINE) && (width_ <= MAX_LINE) && GoalCells( goal, goal_cell_);
+}
+
+int LinearConflictHeuristic::LineConflicts( const Position& position, int first, int step, int count, bool row, int swap_a, int swap_b) const {
+    int line = row ? first / width_ : first % width_;
+    int keys[MAX_LINE];
+    int size = 0;
+    for ( int index = 0, cell = first; index < count; ++index, cell += step ) {
+        int value = position.GetField( (cell == swap_a) ? swap_b : ((cell == swap_b) ? swap_a : cell));
+        if ( (value <= 0) || (size_t( value) >= goal_cell_.size()) || (goal_cell_[value] < 0) ) {
+            continue;
+        }
+        int goal = goal_cell_[value];
+        if ( row && (goal / width_ == line) ) {
+            keys[size++] = goal % width_;
+        } else if ( !row && (goal % width_ == line) ) {
+            keys[size++] = goal / width_;
+        }
+    }
+    int ordered[MAX_LINE];
+    int longest = 0;
+    for ( int i = 0; i < size; ++i ) {
+        ordered[i] = 1;
+        for ( int j = 0; j < i; ++j ) {
+            if ( keys[j] < keys[i] ) {
+                ordered[i] = std::max( ordered[i], ordered[j] + 1);
+            }
+        }
+        longest = std::max( longest, ordered[i]);
+    }
+    return 2 * (size - longest);
+}
+
+int LinearConflictHeuristic::Distance( const Position& position) const {
+    int result = 0;
+    for ( int cell = 0; cell < height_ * width_; ++cell ) {
+        int value = position.GetField( cell);
+        if ( (value > 0) && (size_t( value) < goal_cell_.size()) && (goal_cell_[value] >= 0) ) {
+            int goal = goal_cell_[value];
+            result += abs( cell / width_ - goal / width_) + abs( cell % width_ - goal % width_);
+        }
+    }
+    for ( int row = 0; row < height_; ++row ) {
+        result += LineConflicts( position, row * width_, 1, width_, true, -1, -1);
+    }
+    for ( int column = 0; column < width_; ++column ) {
+        result += LineConflicts( position, column, width_, height_, false, -1, -1);
+    }
+    return result;
+}
+
+int LinearConflictHeuristic::UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const {
+    int value, old_cell, new_cell;
+    MovedTile( position, move_from, move_to, value, old_cell, new_cell);
+    int goal = goal_cell_[value];
+    int result = old_distance
+        + abs( new_cell / width_ - goal / width_) + abs( new_cell % width_ - goal % width_)
+        - abs( old_cell / width_ - goal / width_) - abs( old_cell % width_ - goal % width_);
+    // Порядок фишек в линии, вдоль которой сдвинулась фишка, не меняется.
+    if ( old_cell / width_ != new_cell / width_ ) {
+        int old_row = old_cell - old_cell % width_, new_row = new_cell - new_cell % width_;
+        result += LineConflicts( position, old_row, 1, width_, true, -1, -1)
+            + LineConflicts( position, new_row, 1, width_, true, -1, -1)
+            - LineConflicts( position, old_row, 1, width_, true, move_from, move_to)
+            - LineConflicts( position, new_row, 1, width_, true, move_from, move_to);
+    } else {
+        int old_column = old_cell % width_, new_column = new_cell % width_;
+        result += LineConflicts( position, old_column, width_, height_, false, -1, -1)
+            + LineConflicts( position, new_column, width_, height_, false, -1, -1)
+            - LineConflicts( position, old_column, width_, height_, false, move_from, move_to)
+            - LineConflicts( position, new_column, width_, height_, false, move_from, move_to);
+    }
+    return result;
+}
+
+Heuristic* LinearConflictHeuristic::Clone() const {
+    return new LinearConflictHeuristic( *this);
+}
+
+// Таблица расстояний для одного направления: lines линий по size клеток,
+// пустое место цели в линии blank. Ключ - матрица lines x lines (сколько фишек
+// каждой целевой линии стоит в каждой линии) по bits бит на элемент и номер
+// линии пустого места в старших битах.
+struct WalkingDistanceHeuristic::Table {
+    Table( int lines_, int size, int blank);
+    uint64_t One( int line, int goal_line) const {
+        return uint64_t( 1) << ((line * lines + goal_line) * bits);
+    }
+    int lines;
+    int bits;
+    int blank_shift;
+    std::vector<uint64_t> keys;
+    std::vector<unsigned char> distances;
+};
+
+WalkingDistanceHeuristic::Table::Table( int lines_, int size, int blank)
+    : lines( lines_), bits( BitWidth( size)), blank_shift( lines_ * lines_ * BitWidth( size)) {
+    uint64_t mask = (uint64_t( 1) << bits) - 1;
+    uint64_t start = uint64_t( blank) << blank_shift;
+    for ( int line = 0; line < lines; ++line ) {
+        start += One( line, line) * uint64_t( (line == blank) ? size - 1 : size);
+    }
+    std::map<uint64_t, unsigned char> visited;
+    std::vector<uint64_t> queue( 1, start);
+    visited[start] = 0;
+    for ( size_t index = 0; index < queue.size(); ++index ) {
+        uint64_t key = queue[index];
+        int distance = visited[key];
+        int from = int( key >> blank_shift);
+        for ( int to = from - 1; to <= from + 1; to += 2 ) {
+            if ( (to < 0) || (to >= lines) ) {
+                continue;
+            }
+            for ( int goal_line = 0; goal_line < lines; ++goal_line ) {
+                if ( !((key >> ((to * lines + goal_line) * bits)) & mask) ) {
+                    continue;
+                }
+                uint64_t next = key - One( to, goal_line) + One( from, goal_line)
+                    - (uint64_t( from) << blank_shift) + (uint64_t( to) << blank_shift);
+                if ( visited.insert( std::make_pair( next, (unsigned char)( distance + 1))).second ) {
+                    queue.push_back( next);
+                }
+            }
+        }
+    }
+    for ( std::map<uint64_t, unsigned char>::const_iterator it = visited.begin(); it != visited.end(); ++it ) {
+        keys.push_back( it->first);
+        distances.push_back( it->second);
+    }
+}
+
+namespace {
+
+std::shared_ptr<const WalkingDistanceHeuristic::Table> WalkingDistanceTable( int lines, int size, int blank) {
+    static std::mutex mutex;
+    static std::map< std::vector<int>, std::shared_ptr<const WalkingDistanceHeuristic::Table> > cache;
+    std::vector<int> shape;
+    shape.push_back( lines);
+    shape.push_back( size);
+    shape.push_back( blank);
+    std::lock_guard<std::mutex> lock( mutex);
+    std::shared_ptr<const WalkingDistanceHeuristic::Table>& table = cache[shape];
+    if ( !table ) {
+        table.reset( new WalkingDistanceHeuristic::Table( lines, size, blank));
+    }
+    return table;
+}
+
+} // namespace
+
+bool WalkingDistanceHeuristic::Prepare( const Position& goal) {
+    height_ = goal.Height();
+    width_ = goal.Width();
+    std::vector<int> goal_cell;
+    if ( !GoalCells( goal, goal_cell) ) {
+        return false;
+    }
+    int blank = -1;
+    for ( int cell = 0; cell < height_ * width_; ++cell ) {
+        int value = goal.GetField( cell);
+        if ( (value == Position::STONE) || ((value == Position::BLANK) && (blank >= 0)) ) {
+            return false;
+        }
+        if ( value == Position::BLANK ) {
+            blank = cell;
+        }
+    }
+    if ( (blank < 0) || (height_ * height_ * BitWidth( width_) + BitWidth( height_) > 64)
+         || (width_ * width_ * BitWidth( height_) + BitWidth( width_) > 64) ) {
+        return false;
+    }
+    goal_row_.assign( goal_cell.size(), 0);
+    goal_column_.assign( goal_cell.size(), 0);
+    for ( size_t value = 0; value < goal_cell.size(); ++value ) {
+        if ( goal_cell[value] >= 0 ) {
+            goal_row_[value] = goal_cell[value] / width_;
+            goal_column_[value] = goal_cell[value] % width_;
+        }
+    }
+    vertical_ = WalkingDistanceTable( height_, width_, blank / width_);
+    horizontal_ = WalkingDistanceTable( width_, height_, blank % width_);
+    return true;
+}
+
+uint64_t WalkingDistanceHeuristic::Key( const Position& position, bool vertical) const {
+    const Table& table = vertical ? *vertical_ : *horizontal_;
+    uint64_t key = 0;
+    for ( int cell = 0; cell < height_ * width_; ++cell ) {
+        int value = position.GetField( cell);
+        int line = vertical ? cell / width_ : cell % width_;
+        if ( value == Position::BLANK ) {
+            key += uint64_t( line) << table.blank_shift;
+        } else {
+            key += table.One( line, vertical ? goal_row_[value] : goal_column_[value]);
+        }
+    }
+    return key;
+}
+
+int WalkingDistanceHeuristic::Lookup( bool vertical, uint64_t key) const {
+    const Table& table = vertical ? *vertical_ : *horizontal_;
+    std::vector<uint64_t>::const_iterator place = std::lower_bound( table.keys.begin(), table.keys.end(), key);
+    if ( (place == table.keys.end()) || (*place != key) ) {
+        // Состояние недостижимо из цели: позиция неразрешима.
+        return 0;
+    }
+    return table.distances[place - table.keys.begin()];
+}
+
+int WalkingDistanceHeuristic::Distance( const Position& position) const {
+    return Lookup( true, Key( position, true)) + Lookup( false, Key( position, false));
+}
+
+int WalkingDistanceHeuristic::UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const {
+    int value, old_cell, new_cell;
+    MovedTile( position, move_from, move_to, value, old_cell, new_cell);
+    bool vertical = (old_cell / width_ != new_cell / width_);
+    const Table& table = vertical ? *vertical_ : *horizontal_;
+    int old_line = vertical ? old_cell / width_ : old_cell % width_;
+    int new_line = vertical ? new_cell / width_ : new_cell % width_;
+    int goal_line = vertical ? goal_row_[value] : goal_column_[value];
+    uint64_t key = Key( position, vertical);
+    uint64_t old_key = key - table.One( new_line, goal_line) + table.One( old_line, goal_line)
+        - (uint64_t( old_line) << table.blank_shift) + (uint64_t( new_line) << table.blank_shift);
+    return old_distance - Lookup( vertical, old_key) + Lookup( vertical, key);
+}
+
+Heuristic* WalkingDistanceHeuristic::Clone() const {
+    return new WalkingDistanceHeuristic( *this);
+}
@@ -0,0 +1,112 @@
+#pragma once
+#ifndef _HEURISTIC_H_
+#define _HEURISTIC_H_
+
+#include <stdint.h>
+#include <vector>
+#include <utility>
+#include <memory>
+#include "position.h"
+#include "pattern_database.h"
+
+// Стратегия эвристической оценки расстояния до цели. Поисковик получает
+// прототип, копирует его для каждой стороны поиска через Clone и настраивает
+// копию на свою цель через Prepare.
+class Heuristic {
+public:
+    virtual ~Heuristic() {}
+    // Настраивает оценку на цель goal. false, если для такой цели оценка неприменима.
+    virtual bool Prepare( const Position& goal) = 0;
+    virtual int Distance( const Position& position) const = 0;
+    // Оценка после хода, поменявшего местами клетки move_from и move_to;
+    // position - позиция после хода, old_distance - оценка до него.
+    virtual int UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const = 0;
+    virtual Heuristic* Clone() const = 0;
+};
+
+// Копия prototype (или манхэттенская оценка, если prototype == 0 или не
+// подходит к цели), настроенная на goal.
+std::unique_ptr<Heuristic> PrepareHeuristic( const Heuristic* prototype, const Position& goal);
+
+// Манхэттенское расстояние. Prepare строит таблицу [значение][клетка] с
+// расстоянием до ближайшей клетки цели с тем же значением, после чего
+// пересчет после хода - один поиск в таблице. При слишком больших значениях
+// фишек используются Position::Distance и Position::UpdateDistance.
+class ManhattanHeuristic : public Heuristic {
+public:
+    virtual bool Prepare( const Position& goal);
+    virtual int Distance( const Position& position) const;
+    virtual int UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const;
+    virtual Heuristic* Clone() const;
+    const static int MAX_TABLE_VALUE;
+private:
+    Position goal_;
+    int cells_;
+    // Пусто, если таблица не построена.
+    std::vector<int> table_;
+};
+
+// Оценка по базе шаблонов; применима только к цели, для которой построена база.
+class PatternDatabaseHeuristic : public Heuristic {
+public:
+    explicit PatternDatabaseHeuristic( const PatternDatabase& database);
+    virtual bool Prepare( const Position& goal);
+    virtual int Distance( const Position& position) const;
+    virtual int UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const;
+    virtual Heuristic* Clone() const;
+private:
+    const PatternDatabase& database_;
+};
+
+// Манхэттенское расстояние плюс линейные конфликты: если две фишки стоят в
+// своей целевой строке (столбце) в обратном порядке, одной из них придется
+// покинуть строку, что стоит еще двух ходов. Для каждой линии добавляется
+// 2 * (число фишек линии - длина наибольшей упорядоченной подпоследовательности).
+// Требует различных фишек в цели, камни и несколько пустых мест допускаются.
+class LinearConflictHeuristic : public Heuristic {
+public:
+    virtual bool Prepare( const Position& goal);
+    virtual int Distance( const Position& position) const;
+    // Пересчитываются только две строки (или два столбца), затронутые ходом.
+    virtual int UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const;
+    virtual Heuristic* Clone() const;
+private:
+    // Конфликты в линии из count клеток, начиная с first с шагом step.
+    // Клетки swap_a и swap_b читаются переставленными местами.
+    int LineConflicts( const Position& position, int first, int step, int count, bool row, int swap_a, int swap_b) const;
+    int height_;
+    int width_;
+    // Для значения фишки - ее клетка в цели, -1 для прочих значений.
+    std::vector<int> goal_cell_;
+};
+
+// Walking distance: отдельно по вертикали и горизонтали считается точное
+// расстояние в ослабленной задаче, где учитывается только, сколько фишек
+// каждой целевой строки (столбца) стоит в каждой строке (столбце).
+// Таблицы строятся поиском в ширину один раз для формы поля и положения
+// пустого места в цели и разделяются всеми копиями.
+// Требует одного пустого места, различных фишек и отсутствия камней.
+class WalkingDistanceHeuristic : public Heuristic {
+public:
+    virtual bool Prepare( const Position& goal);
+    virtual int Distance( const Position& position) const;
+    // Пересчитывается только таблица направления хода: ключ после хода строится
+    // одним обходом всего поля, то есть за O(клеток), а не O(строки + столбца),
+    // ключ до хода получается из него сдвигом одной фишки. Хранить ключ между
+    // ходами негде - интерфейс передает только old_distance.
+    virtual int UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const;
+    virtual Heuristic* Clone() const;
+    struct Table;
+private:
+    // Ключ состояния по строкам (vertical) или по столбцам.
+    uint64_t Key( const Position& position, bool vertical) const;
+    int Lookup( bool vertical, uint64_t key) const;
+    int height_;
+    int width_;
+    std::vector<int> goal_row_;
+    std::vector<int> goal_column_;
+    std::shared_ptr<const Table> vertical_;
+    std::shared_ptr<const Table> horizontal_;
+};
+
+#endif /* _HEURISTIC_H_ */
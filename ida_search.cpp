@@ -0,0 +1,142 @@
+#include "ida_search.h"
+#include "reachability.h"
+#include <algorithm>
+#include <limits>
+
+const int IDAStarSearcher::FOUND = -1;
+const int IDAStarSearcher::NOT_FOUND = std::numeric_limits<int>::max();
+
+IDAStarSearcher::IDAStarSearcher()
+    : prototype_( 0), nodes_( 0), limit_( 0), time_limit_( 0), control_( 0), interrupted_( NOT_STOPPED), best_h_( 0), cancel_( 0),
+      item_( 0), cancelled_( false) {
+}
+
+int IDAStarSearcher::DepthSearch( int cost, int h, int threshold) {
+    if ( cost + h > threshold ) {
+        return cost + h;
+    }
+    if ( !h && (position_ == goal_) ) {
+        return FOUND;
+    }
+    if ( ++nodes_ > limit_ ) {
+        return NOT_FOUND;
+    }
+    if ( !(nodes_ & 4095) ) {
+        if ( progress_ ) {
+            UpdateStats();
+            progress_( stats_);
+        }
+        interrupted_ = budget_.Check( 0);
+        if ( cancel_ && (cancel_->load( std::memory_order_relaxed) < item_) ) {
+            cancelled_ = true;
+        }
+    }
+    if ( (interrupted_ != NOT_STOPPED) || cancelled_ ) {
+        return NOT_FOUND;
+    }
+    if ( h < best_h_ ) {
+        best_h_ = h;
+        best_path_ = path_;
+    }
+    SideStats& stats = stats_.sides[SearchStats::SOURCE];
+    stats.peak_opened = std::max( stats.peak_opened, size_t( cost));
+    Position::MoveList& moves = moves_[cost];
+    {
+        ProfileScope scope( stats.move_generation_seconds);
+        position_.GetPossibleMoves( neighbors_, moves);
+    }
+    int next_threshold = NOT_FOUND;
+    for ( int index = 0; index < moves.Size(); ++index ) {
+        const Position::Move* move = &moves[index];
+        // Ход, отменяющий предыдущий, не может лежать на кратчайшем пути.
+        if ( !path_.empty() && (path_.back() == *move) ) {
+            continue;
+        }
+        position_.Swap( move->from, move->to);
+        path_.push_back( *move);
+        ++stats.generated;
+        int next_h;
+        {
+            ProfileScope scope( stats.heuristic_seconds);
+            next_h = heuristic_->UpdateDistance( position_, h, move->from, move->to);
+        }
+        int result = DepthSearch( cost + 1, next_h, threshold);
+        if ( result == FOUND ) {
+            return FOUND;
+        }
+        path_.pop_back();
+        position_.Swap( move->from, move->to);
+        next_threshold = std::min( next_threshold, result);
+    }
+    return next_threshold;
+}
+
+std::vector<Position> IDAStarSearcher::Replay( const Position& source, const std::vector<Position::Move>& moves) {
+    std::vector<Position> way;
+    Position position = source;
+    way.push_back( position);
+    for ( std::vector<Position::Move>::const_iterator move = moves.begin(); move != moves.end(); ++move ) {
+        position.Swap( move->from, move->to);
+        way.push_back( position);
+    }
+    return way;
+}
+
+void IDAStarSearcher::UpdateStats() {
+    SideStats& stats = stats_.sides[SearchStats::SOURCE];
+    stats.expanded = nodes_;
+    // Каждая порожденная позиция оценивается один раз, плюс начальная.
+    stats.heuristic_evaluations = stats.generated + 1;
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    return;
+}
+
+std::vector<Position> IDAStarSearcher::Search( const Position& source, const Position& goal, long long limit, std::string& error_msg) {
+    error_msg = "";
+    std::vector<Position> way;
+    nodes_ = 0;
+    stats_.Clear();
+    partial_.clear();
+    if ( !CheckReachability( source, goal, error_msg) ) {
+        return way;
+    }
+    position_ = source;
+    goal_ = goal;
+    path_.clear();
+    neighbors_ = NeighborTable( source);
+    start_ = std::chrono::steady_clock::now();
+    budget_.Start( control_, limit, time_limit_);
+    limit_ = budget_.NodeLimit();
+    interrupted_ = NOT_STOPPED;
+    heuristic_ = PrepareHeuristic( prototype_, goal_);
+    int h = heuristic_->Distance( position_);
+    best_h_ = h;
+    best_path_.clear();
+    int threshold = h;
+    int result = NOT_FOUND;
+    while ( (nodes_ <= limit_) && (interrupted_ == NOT_STOPPED) ) {
+        // Раскрываются только вершины с cost <= threshold.
+        if ( moves_.size() <= size_t( threshold) ) {
+            moves_.resize( threshold + 1);
+        }
+        result = DepthSearch( 0, h, threshold);
+        if ( (result == FOUND) || (result == NOT_FOUND) ) {
+            break;
+        }
+        threshold = result;
+    }
+    UpdateStats();
+    if ( result != FOUND ) {
+        if ( (interrupted_ == NOT_STOPPED) && (nodes_ > limit_) ) {
+            interrupted_ = NODE_LIMIT;
+        }
+        if ( interrupted_ != NOT_STOPPED ) {
+            error_msg = StopMessage( interrupted_);
+            partial_ = Replay( source, best_path_);
+        } else {
+            error_msg = "No solution";
+        }
+        return way;
+    }
+    return Replay( source, path_);
+}
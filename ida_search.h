@@ -0,0 +1,81 @@
+#pragma once
+#ifndef _IDA_SEARCH_H_
+#define _IDA_SEARCH_H_
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include "position.h"
+#include "heuristic.h"
+#include "search_stats.h"
+#include "search_control.h"
+
+// Поиск с итеративным углублением (IDA*). Память не зависит от числа
+// просмотренных вершин: в каждый момент хранится одна позиция, изменяемая
+// на месте, и стек ходов до нее.
+class IDAStarSearcher {
+public:
+    IDAStarSearcher();
+    // Прототип оценки расстояния; если он не задан или не применим к цели,
+    // используется манхэттенская оценка.
+    void SetHeuristic( const Heuristic* heuristic) {prototype_ = heuristic;}
+    // Ограничение времени одного вызова Search в секундах, 0 - без ограничения.
+    void SetTimeLimit( double seconds) {time_limit_ = seconds;}
+    // Внешние ограничения и отмена, 0 - нет. Память IDA* не ограничивается.
+    void SetControl( const SearchControl* control) {control_ = control;}
+    // Число раскрытых вершин в последнем вызове Search.
+    long long NodesExpanded() const {return nodes_;}
+    // Статистика последнего вызова Search (сторона SOURCE); повторы и
+    // переоткрытия IDA* не отслеживает.
+    const SearchStats& Stats() const {return stats_;}
+    // Вызывается раз в 4096 раскрытых вершин.
+    void SetProgress( const ProgressCallback& progress) {progress_ = progress;}
+    // limit - ограничение на число раскрытых вершин.
+    std::vector<Position> Search( const Position& source, const Position& goal, long long limit, std::string& error_msg);
+    // Путь от начальной позиции до раскрытой вершины с наименьшей оценкой,
+    // если последний Search прерван ограничением или отменой; иначе пуст.
+    const std::vector<Position>& BestPartial() const {return partial_;}
+private:
+    friend class ParallelIDAStarSearcher;
+    // Возвращает FOUND, если цель найдена в пределах threshold, иначе
+    // наименьшую оценку вершины, вышедшей за порог.
+    int DepthSearch( int cost, int h, int threshold);
+    // Переносит nodes_ и время в stats_.
+    void UpdateStats();
+    // Позиции пути из source по ходам moves.
+    static std::vector<Position> Replay( const Position& source, const std::vector<Position::Move>& moves);
+    const static int FOUND;
+    const static int NOT_FOUND;
+    const Heuristic* prototype_;
+    // Оценка, настроенная на цель текущего поиска.
+    std::unique_ptr<Heuristic> heuristic_;
+    Position position_;
+    Position goal_;
+    // Ходы от начальной позиции до текущей.
+    std::vector<Position::Move> path_;
+    NeighborTable neighbors_;
+    // Буферы ходов для каждой глубины.
+    std::vector<Position::MoveList> moves_;
+    long long nodes_;
+    long long limit_;
+    double time_limit_;
+    const SearchControl* control_;
+    SearchBudget budget_;
+    // Причина остановки, NOT_STOPPED - нет.
+    StopReason interrupted_;
+    // Наименьшая оценка раскрытой вершины и ходы до нее.
+    int best_h_;
+    std::vector<Position::Move> best_path_;
+    std::vector<Position> partial_;
+    SearchStats stats_;
+    ProgressCallback progress_;
+    std::chrono::steady_clock::time_point start_;
+    // При поиске в поддереве номер item_ из ParallelIDAStarSearcher: поиск
+    // прерывается, как только *cancel_ станет меньше item_.
+    const std::atomic<int>* cancel_;
+    int item_;
+    bool cancelled_;
+};
+
+#endif /* _IDA_SEARCH_H_ */
@@ -0,0 +1,327 @@
+#include "instances.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+
+uint64_t Random::Next() {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t Random::Uniform( uint64_t bound) {
+    // Отбрасываются значения из неполного последнего интервала, чтобы не было смещения.
+    uint64_t limit = uint64_t( -1) - uint64_t( -1) % bound;
+    uint64_t value;
+    do {
+        value = Next();
+    } while ( value >= limit );
+    return value % bound;
+}
+
+Position StandardGoal( int height, int width) {
+    std::vector<int> cells;
+    for ( int value = 1; value < height * width; ++value ) {
+        cells.push_back( value);
+    }
+    cells.push_back( Position::BLANK);
+    return Position( height, width, cells);
+}
+
+bool IsSolvablePermutation( const Position& source, const Position& goal) {
+    int width = goal.Width();
+    int cells = goal.Height() * width;
+    // Для значения - клетка в цели.
+    std::vector<int> goal_cell;
+    int source_blank = -1, goal_blank = -1;
+    for ( int index = 0; index < cells; ++index ) {
+        int value = goal.GetField( index);
+        if ( value == Position::BLANK ) {
+            goal_blank = index;
+            continue;
+        }
+        if ( int( goal_cell.size()) <= value ) {
+            goal_cell.resize( value + 1, -1);
+        }
+        goal_cell[value] = index;
+    }
+    for ( int index = 0; index < cells; ++index ) {
+        if ( source.GetField( index) == Position::BLANK ) {
+            source_blank = index;
+        }
+    }
+    // Четность перестановки клеток через число циклов.
+    std::vector<int> target( cells);
+    for ( int index = 0; index < cells; ++index ) {
+        int value = source.GetField( index);
+        target[index] = (value == Position::BLANK) ? goal_blank : goal_cell[value];
+    }
+    std::vector<bool> visited( cells, false);
+    int cycles = 0;
+    for ( int index = 0; index < cells; ++index ) {
+        if ( visited[index] ) {
+            continue;
+        }
+        ++cycles;
+        for ( int cell = index; !visited[cell]; cell = target[cell] ) {
+            visited[cell] = true;
+        }
+    }
+    int permutation_parity = (cells - cycles) & 1;
+    int blank_distance = std::abs( source_blank / width - goal_blank / width) + std::abs( source_blank % width - goal_blank % width);
+    return permutation_parity == (blank_distance & 1);
+}
+
+Position RandomSolvable( const Position& goal, Random& random) {
+    int cells = goal.Height() * goal.Width();
+    std::vector<int> values;
+    for ( int index = 0; index < cells; ++index ) {
+        values.push_back( goal.GetField( index));
+    }
+    for ( int index = cells - 1; index > 0; --index ) {
+        std::swap( values[index], values[random.Uniform( index + 1)]);
+    }
+    Position position( goal.Height(), goal.Width(), values);
+    if ( !IsSolvablePermutation( position, goal) ) {
+        // Обмен двух фишек меняет четность; отображение взаимно однозначно
+        // между половинами, так что распределение остается равномерным.
+        int first = (values[0] == Position::BLANK) ? 1 : 0;
+        int second = (values[first + 1] == Position::BLANK) ? first + 2 : first + 1;
+        position.Swap( first, second);
+    }
+    return position;
+}
+
+Position RandomWalk( const Position& goal, int step_count, Random& random) {
+    Position position = goal;
+    std::vector<Position::Move> moves;
+    Position::Move last;
+    bool has_last = false;
+    for ( int step = 0; step < step_count; ++step ) {
+        position.GetPossibleMoves( moves);
+        if ( has_last && (moves.size() > 1) ) {
+            moves.erase( std::remove( moves.begin(), moves.end(), last), moves.end());
+        }
+        if ( moves.empty() ) {
+            break;
+        }
+        last = moves[random.Uniform( moves.size())];
+        has_last = true;
+        position.Swap( last.from, last.to);
+    }
+    return position;
+}
+
+namespace {
+
+// 100 задач Корфа (R. E. Korf, Depth-first iterative-deepening, 1985), цель -
+// KorfGoal.
+const int KORF_INSTANCES[KORF_INSTANCE_COUNT][16] = {
+    {14, 13, 15, 7, 11, 12, 9, 5, 6, 0, 2, 1, 4, 8, 10, 3},
+    {13, 5, 4, 10, 9, 12, 8, 14, 2, 3, 7, 1, 0, 15, 11, 6},
+    {14, 7, 8, 2, 13, 11, 10, 4, 9, 12, 5, 0, 3, 6, 1, 15},
+    {5, 12, 10, 7, 15, 11, 14, 0, 8, 2, 1, 13, 3, 4, 9, 6},
+    {4, 7, 14, 13, 10, 3, 9, 12, 11, 5, 6, 15, 1, 2, 8, 0},
+    {14, 7, 1, 9, 12, 3, 6, 15, 8, 11, 2, 5, 10, 0, 4, 13},
+    {2, 11, 15, 5, 13, 4, 6, 7, 12, 8, 10, 1, 9, 3, 14, 0},
+    {12, 11, 15, 3, 8, 0, 4, 2, 6, 13, 9, 5, 14, 1, 10, 7},
+    {3, 14, 9, 11, 5, 4, 8, 2, 13, 12, 6, 7, 10, 1, 15, 0},
+    {13, 11, 8, 9, 0, 15, 7, 10, 4, 3, 6, 14, 5, 12, 2, 1},
+    {5, 9, 13, 14, 6, 3, 7, 12, 10, 8, 4, 0, 15, 2, 11, 1},
+    {14, 1, 9, 6, 4, 8, 12, 5, 7, 2, 3, 0, 10, 11, 13, 15},
+    {3, 6, 5, 2, 10, 0, 15, 14, 1, 4, 13, 12, 9, 8, 11, 7},
+    {7, 6, 8, 1, 11, 5, 14, 10, 3, 4, 9, 13, 15, 2, 0, 12},
+    {13, 11, 4, 12, 1, 8, 9, 15, 6, 5, 14, 2, 7, 3, 10, 0},
+    {1, 3, 2, 5, 10, 9, 15, 6, 8, 14, 13, 11, 12, 4, 7, 0},
+    {15, 14, 0, 4, 11, 1, 6, 13, 7, 5, 8, 9, 3, 2, 10, 12},
+    {6, 0, 14, 12, 1, 15, 9, 10, 11, 4, 7, 2, 8, 3, 5, 13},
+    {7, 11, 8, 3, 14, 0, 6, 15, 1, 4, 13, 9, 5, 12, 2, 10},
+    {6, 12, 11, 3, 13, 7, 9, 15, 2, 14, 8, 10, 4, 1, 5, 0},
+    {12, 8, 14, 6, 11, 4, 7, 0, 5, 1, 10, 15, 3, 13, 9, 2},
+    {14, 3, 9, 1, 15, 8, 4, 5, 11, 7, 10, 13, 0, 2, 12, 6},
+    {10, 9, 3, 11, 0, 13, 2, 14, 5, 6, 4, 7, 8, 15, 1, 12},
+    {7, 3, 14, 13, 4, 1, 10, 8, 5, 12, 9, 11, 2, 15, 6, 0},
+    {11, 4, 2, 7, 1, 0, 10, 15, 6, 9, 14, 8, 3, 13, 5, 12},
+    {5, 7, 3, 12, 15, 13, 14, 8, 0, 10, 9, 6, 1, 4, 2, 11},
+    {14, 1, 8, 15, 2, 6, 0, 3, 9, 12, 10, 13, 4, 7, 5, 11},
+    {13, 14, 6, 12, 4, 5, 1, 0, 9, 3, 10, 2, 15, 11, 8, 7},
+    {9, 8, 0, 2, 15, 1, 4, 14, 3, 10, 7, 5, 11, 13, 6, 12},
+    {12, 15, 2, 6, 1, 14, 4, 8, 5, 3, 7, 0, 10, 13, 9, 11},
+    {12, 8, 15, 13, 1, 0, 5, 4, 6, 3, 2, 11, 9, 7, 14, 10},
+    {14, 10, 9, 4, 13, 6, 5, 8, 2, 12, 7, 0, 1, 3, 11, 15},
+    {14, 3, 5, 15, 11, 6, 13, 9, 0, 10, 2, 12, 4, 1, 7, 8},
+    {6, 11, 7, 8, 13, 2, 5, 4, 1, 10, 3, 9, 14, 0, 12, 15},
+    {1, 6, 12, 14, 3, 2, 15, 8, 4, 5, 13, 9, 0, 7, 11, 10},
+    {12, 6, 0, 4, 7, 3, 15, 1, 13, 9, 8, 11, 2, 14, 5, 10},
+    {8, 1, 7, 12, 11, 0, 10, 5, 9, 15, 6, 13, 14, 2, 3, 4},
+    {7, 15, 8, 2, 13, 6, 3, 12, 11, 0, 4, 10, 9, 5, 1, 14},
+    {9, 0, 4, 10, 1, 14, 15, 3, 12, 6, 5, 7, 11, 13, 8, 2},
+    {11, 5, 1, 14, 4, 12, 10, 0, 2, 7, 13, 3, 9, 15, 6, 8},
+    {8, 13, 10, 9, 11, 3, 15, 6, 0, 1, 2, 14, 12, 5, 4, 7},
+    {4, 5, 7, 2, 9, 14, 12, 13, 0, 3, 6, 11, 8, 1, 15, 10},
+    {11, 15, 14, 13, 1, 9, 10, 4, 3, 6, 2, 12, 7, 5, 8, 0},
+    {12, 9, 0, 6, 8, 3, 5, 14, 2, 4, 11, 7, 10, 1, 15, 13},
+    {3, 14, 9, 7, 12, 15, 0, 4, 1, 8, 5, 6, 11, 10, 2, 13},
+    {8, 4, 6, 1, 14, 12, 2, 15, 13, 10, 9, 5, 3, 7, 0, 11},
+    {6, 10, 1, 14, 15, 8, 3, 5, 13, 0, 2, 7, 4, 9, 11, 12},
+    {8, 11, 4, 6, 7, 3, 10, 9, 2, 12, 15, 13, 0, 1, 5, 14},
+    {10, 0, 2, 4, 5, 1, 6, 12, 11, 13, 9, 7, 15, 3, 14, 8},
+    {12, 5, 13, 11, 2, 10, 0, 9, 7, 8, 4, 3, 14, 6, 15, 1},
+    {10, 2, 8, 4, 15, 0, 1, 14, 11, 13, 3, 6, 9, 7, 5, 12},
+    {10, 8, 0, 12, 3, 7, 6, 2, 1, 14, 4, 11, 15, 13, 9, 5},
+    {14, 9, 12, 13, 15, 4, 8, 10, 0, 2, 1, 7, 3, 11, 5, 6},
+    {12, 11, 0, 8, 10, 2, 13, 15, 5, 4, 7, 3, 6, 9, 14, 1},
+    {13, 8, 14, 3, 9, 1, 0, 7, 15, 5, 4, 10, 12, 2, 6, 11},
+    {3, 15, 2, 5, 11, 6, 4, 7, 12, 9, 1, 0, 13, 14, 10, 8},
+    {5, 11, 6, 9, 4, 13, 12, 0, 8, 2, 15, 10, 1, 7, 3, 14},
+    {5, 0, 15, 8, 4, 6, 1, 14, 10, 11, 3, 9, 7, 12, 2, 13},
+    {15, 14, 6, 7, 10, 1, 0, 11, 12, 8, 4, 9, 2, 5, 13, 3},
+    {11, 14, 13, 1, 2, 3, 12, 4, 15, 7, 9, 5, 10, 6, 8, 0},
+    {6, 13, 3, 2, 11, 9, 5, 10, 1, 7, 12, 14, 8, 4, 0, 15},
+    {4, 6, 12, 0, 14, 2, 9, 13, 11, 8, 3, 15, 7, 10, 1, 5},
+    {8, 10, 9, 11, 14, 1, 7, 15, 13, 4, 0, 12, 6, 2, 5, 3},
+    {5, 2, 14, 0, 7, 8, 6, 3, 11, 12, 13, 15, 4, 10, 9, 1},
+    {7, 8, 3, 2, 10, 12, 4, 6, 11, 13, 5, 15, 0, 1, 9, 14},
+    {11, 6, 14, 12, 3, 5, 1, 15, 8, 0, 10, 13, 9, 7, 4, 2},
+    {7, 1, 2, 4, 8, 3, 6, 11, 10, 15, 0, 5, 14, 12, 13, 9},
+    {7, 3, 1, 13, 12, 10, 5, 2, 8, 0, 6, 11, 14, 15, 4, 9},
+    {6, 0, 5, 15, 1, 14, 4, 9, 2, 13, 8, 10, 11, 12, 7, 3},
+    {15, 1, 3, 12, 4, 0, 6, 5, 2, 8, 14, 9, 13, 10, 7, 11},
+    {5, 7, 0, 11, 12, 1, 9, 10, 15, 6, 2, 3, 8, 4, 13, 14},
+    {12, 15, 11, 10, 4, 5, 14, 0, 13, 7, 1, 2, 9, 8, 3, 6},
+    {6, 14, 10, 5, 15, 8, 7, 1, 3, 4, 2, 0, 12, 9, 11, 13},
+    {14, 13, 4, 11, 15, 8, 6, 9, 0, 7, 3, 1, 2, 10, 12, 5},
+    {14, 4, 0, 10, 6, 5, 1, 3, 9, 2, 13, 15, 12, 7, 8, 11},
+    {15, 10, 8, 3, 0, 6, 9, 5, 1, 14, 13, 11, 7, 2, 12, 4},
+    {0, 13, 2, 4, 12, 14, 6, 9, 15, 1, 10, 3, 11, 5, 8, 7},
+    {3, 14, 13, 6, 4, 15, 8, 9, 5, 12, 10, 0, 2, 7, 1, 11},
+    {0, 1, 9, 7, 11, 13, 5, 3, 14, 12, 4, 2, 8, 6, 10, 15},
+    {11, 0, 15, 8, 13, 12, 3, 5, 10, 1, 4, 6, 14, 9, 7, 2},
+    {13, 0, 9, 12, 11, 6, 3, 5, 15, 8, 1, 10, 4, 14, 2, 7},
+    {14, 10, 2, 1, 13, 9, 8, 11, 7, 3, 6, 12, 15, 5, 4, 0},
+    {12, 3, 9, 1, 4, 5, 10, 2, 6, 11, 15, 0, 14, 7, 13, 8},
+    {15, 8, 10, 7, 0, 12, 14, 1, 5, 9, 6, 3, 13, 11, 4, 2},
+    {4, 7, 13, 10, 1, 2, 9, 6, 12, 8, 14, 5, 3, 0, 11, 15},
+    {6, 0, 5, 10, 11, 12, 9, 2, 1, 7, 4, 3, 14, 8, 13, 15},
+    {9, 5, 11, 10, 13, 0, 2, 1, 8, 6, 14, 12, 4, 7, 3, 15},
+    {15, 2, 12, 11, 14, 13, 9, 5, 1, 3, 8, 7, 0, 10, 6, 4},
+    {11, 1, 7, 4, 10, 13, 3, 8, 9, 14, 0, 15, 6, 5, 2, 12},
+    {5, 4, 7, 1, 11, 12, 14, 15, 10, 13, 8, 6, 2, 0, 9, 3},
+    {9, 7, 5, 2, 14, 15, 12, 10, 11, 3, 6, 1, 8, 13, 0, 4},
+    {3, 2, 7, 9, 0, 15, 12, 4, 6, 11, 5, 14, 8, 13, 10, 1},
+    {13, 9, 14, 6, 12, 8, 1, 2, 3, 4, 0, 7, 5, 10, 11, 15},
+    {5, 7, 11, 8, 0, 14, 9, 13, 10, 12, 3, 15, 6, 1, 4, 2},
+    {4, 3, 6, 13, 7, 15, 9, 0, 10, 5, 8, 11, 2, 12, 1, 14},
+    {1, 7, 15, 14, 2, 6, 4, 9, 12, 11, 13, 3, 0, 8, 5, 10},
+    {9, 14, 5, 7, 8, 15, 1, 2, 10, 4, 13, 6, 12, 0, 11, 3},
+    {0, 11, 3, 12, 5, 2, 1, 9, 8, 10, 14, 15, 7, 4, 13, 6},
+    {7, 15, 4, 0, 10, 9, 2, 5, 12, 11, 13, 6, 1, 3, 14, 8},
+    {11, 4, 0, 8, 6, 10, 5, 13, 12, 7, 14, 3, 1, 2, 9, 15}
+};
+
+Position KorfGoal() {
+    std::vector<int> cells;
+    for ( int value = 0; value < 16; ++value ) {
+        cells.push_back( value);
+    }
+    return Position( 4, 4, cells);
+}
+
+Instance MakeInstance( const std::string& set, int number, const Position& source, const Position& goal) {
+    std::ostringstream id;
+    id << set << '-' << number;
+    Instance instance;
+    instance.id = id.str();
+    instance.source = source;
+    instance.goal = goal;
+    return instance;
+}
+
+} // namespace
+
+std::vector<std::string> InstanceSetNames() {
+    std::vector<std::string> names;
+    names.push_back( "3x3");
+    names.push_back( "3x4");
+    names.push_back( "4x4");
+    names.push_back( "stones");
+    names.push_back( "duplicates");
+    names.push_back( "korf");
+    return names;
+}
+
+bool MakeInstanceSet( const std::string& name, uint64_t seed, int count, std::vector<Instance>& instances) {
+    Random random( seed);
+    if ( (name == "3x3") || (name == "3x4") || (name == "4x4") ) {
+        Position goal = StandardGoal( name[0] - '0', name[2] - '0');
+        for ( int number = 0; number < count; ++number ) {
+            instances.push_back( MakeInstance( name, number, RandomSolvable( goal, random), goal));
+        }
+    } else if ( name == "stones" ) {
+        Position goal( std::vector< std::vector<int> >{
+            {1, 2, 3, 4},
+            {5, Position::STONE, 6, 7},
+            {8, 9, Position::STONE, 10},
+            {11, 12, 13, Position::BLANK}});
+        for ( int number = 0; number < count; ++number ) {
+            // Длинные блуждания дают задачи, непосильные A* с манхэттенской оценкой.
+            instances.push_back( MakeInstance( name, number, RandomWalk( goal, 80, random), goal));
+        }
+    } else if ( name == "duplicates" ) {
+        Position goal( std::vector< std::vector<int> >{
+            {1, 1, 1, 1},
+            {2, 2, 2, 2},
+            {3, 3, 3, 3},
+            {4, 4, 4, Position::BLANK}});
+        for ( int number = 0; number < count; ++number ) {
+            instances.push_back( MakeInstance( name, number, RandomWalk( goal, 1000, random), goal));
+        }
+    } else if ( name == "korf" ) {
+        // Задачи не случайны, seed не используется; номера с 1, как у Корфа.
+        Position goal = KorfGoal();
+        for ( int number = 0; number < std::min( count, int( KORF_INSTANCE_COUNT)); ++number ) {
+            std::vector<int> cells( KORF_INSTANCES[number], KORF_INSTANCES[number] + 16);
+            instances.push_back( MakeInstance( name, number + 1, Position( 4, 4, cells), goal));
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool LoadKorfInstances( const std::string& file_name, std::vector<Instance>& instances, std::string& error_msg) {
+    error_msg = "";
+    std::ifstream input( file_name.c_str());
+    if ( !input ) {
+        error_msg = "Can't open " + file_name;
+        return false;
+    }
+    Position goal = KorfGoal();
+    std::string line;
+    while ( std::getline( input, line) ) {
+        std::istringstream stream( line);
+        std::string number;
+        if ( !(stream >> number) ) {
+            continue;
+        }
+        std::vector<int> cells( 16);
+        for ( int index = 0; index < 16; ++index ) {
+            if ( !(stream >> cells[index]) || (cells[index] < 0) || (cells[index] > 15) ) {
+                error_msg = "Bad line '" + line + "'";
+                return false;
+            }
+        }
+        Instance instance;
+        instance.id = "korf-" + number;
+        instance.source = Position( 4, 4, cells);
+        instance.goal = goal;
+        if ( !instance.goal.IsSimular( instance.source) ) {
+            error_msg = "Bad line '" + line + "'";
+            return false;
+        }
+        instances.push_back( instance);
+    }
+    return true;
+}
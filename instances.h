@@ -0,0 +1,55 @@
+#pragma once
+#ifndef _INSTANCES_H_
+#define _INSTANCES_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "position.h"
+#include "batch.h"
+
+// Генератор псевдослучайных чисел SplitMix64: одинаковая последовательность
+// для одного зерна на любой платформе, в отличие от rand().
+class Random {
+public:
+    explicit Random( uint64_t seed) : state_( seed) {}
+    uint64_t Next();
+    // Равномерно распределенное число из [0, bound).
+    uint64_t Uniform( uint64_t bound);
+private:
+    uint64_t state_;
+};
+
+// Стандартная цель height x width: фишки 1, 2, ... по порядку, пустое место последним.
+Position StandardGoal( int height, int width);
+
+// true, если source переводится в goal. Только для полей без камней с одним
+// пустым местом и различными фишками: перестановка должна иметь ту же
+// четность, что и манхэттенское расстояние между пустыми местами.
+bool IsSolvablePermutation( const Position& source, const Position& goal);
+
+// Позиция, равномерно выбранная среди разрешимых для цели goal без камней
+// с одним пустым местом и различными фишками.
+Position RandomSolvable( const Position& goal, Random& random);
+
+// Позиция после step_count случайных ходов из goal (для полей с камнями и
+// одинаковыми фишками, где равномерный выбор разрешимых позиций неизвестен).
+Position RandomWalk( const Position& goal, int step_count, Random& random);
+
+// Набор задач с фиксированным зерном. Известные имена:
+//   3x3, 3x4, 4x4 - равномерно случайные разрешимые позиции;
+//   stones        - 4x4 с двумя камнями, случайные блуждания;
+//   duplicates    - 4x4 с повторяющимися фишками, случайные блуждания;
+//   korf          - первые count из KORF_INSTANCE_COUNT задач Корфа (цель как
+//                   в LoadKorfInstances), зерно не используется.
+// false для неизвестного имени.
+enum { KORF_INSTANCE_COUNT = 100 };
+bool MakeInstanceSet( const std::string& name, uint64_t seed, int count, std::vector<Instance>& instances);
+// Имена наборов MakeInstanceSet.
+std::vector<std::string> InstanceSetNames();
+
+// Читает задачи 4x4 в формате Корфа: в строке номер и 16 чисел, цель -
+// пустое место в левом верхнем углу, затем фишки 1..15.
+bool LoadKorfInstances( const std::string& file_name, std::vector<Instance>& instances, std::string& error_msg);
+
+#endif /* _INSTANCES_H_ */
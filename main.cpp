@@ -1,19 +1,208 @@
 #include "position.h"
 #include "search.h"
+#include "heuristic.h"
+#include "symmetry.h"
+#include "pattern_database.h"
+#include "batch.h"
+#include "hda_search.h"
 
-#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void PrintUsage(const char* name) {
+  std::cerr << "Usage: " << name << " [--batch [file] | --hints [file]]"
+            << " [--threads n]"
+            << " [--engine astar|astar2|ida|hda|pida|wastar|ara|mm|bounded]"
+            << " [--search-threads n]"
+            << " [--weight w]"
+            << " [--heuristic manhattan|linear|wd|pdb:<file>]"
+            << " [--nodes n] [--time-ms n] [--memory-mb n] [--partial]"
+            << " [--symmetry] [--binary-output] [--table file]"
+            << " [--cache file] [--cache-mb n]"
+            << std::endl
+            << "Without --batch solves one random 4x4 instance." << std::endl
+            << "Batch input is read from file or stdin, one instance per line:"
+            << " id height width cells... [/ goal cells...]" << std::endl
+            << "--binary-output writes results as 2-bit packed moves"
+            << " (see solution.h)." << std::endl
+            << "--table answers instances with the table's goal from a 15table"
+            << " distance table." << std::endl
+            << "--cache keeps optimal solutions in a shared file (default"
+            << " 64 MB) and reuses them." << std::endl
+            << "astar2 runs both sides of bidirectional A* at once on two"
+            << " threads per instance." << std::endl
+            << "--hints solves lines in order as successive positions of one"
+            << " game, reusing the search tree (--memory-mb bounds the tree)."
+            << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool batch = false;
+  bool hints = false;
+  std::string input_file;
+  BatchOptions options;
+  options.threads = std::max(1u, std::thread::hardware_concurrency());
+  std::string heuristic_name = "manhattan";
+  std::string table_file;
+  std::string cache_file;
+  size_t cache_size = 64u << 20;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--batch" || arg == "--hints") {
+      batch = true;
+      hints = arg == "--hints";
+      if (has_value && argv[i + 1][0] != '-') {
+        input_file = argv[++i];
+      }
+    } else if (arg == "--threads" && has_value) {
+      options.threads = atoi(argv[++i]);
+    } else if (arg == "--engine" && has_value) {
+      std::string engine = argv[++i];
+      if (engine == "ida") {
+        options.engine = BatchOptions::IDASTAR;
+      } else if (engine == "hda") {
+        options.engine = BatchOptions::HDASTAR;
+      } else if (engine == "pida") {
+        options.engine = BatchOptions::PARALLEL_IDASTAR;
+      } else if (engine == "wastar") {
+        options.engine = BatchOptions::WEIGHTED_ASTAR;
+      } else if (engine == "ara") {
+        options.engine = BatchOptions::ARASTAR;
+      } else if (engine == "mm") {
+        options.engine = BatchOptions::MM;
+      } else if (engine == "bounded") {
+        options.engine = BatchOptions::BOUNDED_ASTAR;
+      } else if (engine == "astar2") {
+        options.engine = BatchOptions::CONCURRENT_ASTAR;
+      } else if (engine != "astar") {
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    } else if (arg == "--search-threads" && has_value) {
+      options.search_threads = atoi(argv[++i]);
+    } else if (arg == "--weight" && has_value) {
+      options.weight = atof(argv[++i]);
+    } else if (arg == "--heuristic" && has_value) {
+      heuristic_name = argv[++i];
+    } else if (arg == "--nodes" && has_value) {
+      options.node_limit = atoll(argv[++i]);
+    } else if (arg == "--time-ms" && has_value) {
+      options.time_limit = atof(argv[++i]) / 1000;
+    } else if (arg == "--memory-mb" && has_value) {
+      options.memory_limit = size_t(atof(argv[++i]) * 1024 * 1024);
+    } else if (arg == "--partial") {
+      options.partial = true;
+    } else if (arg == "--symmetry") {
+      options.symmetry = true;
+    } else if (arg == "--table" && has_value) {
+      table_file = argv[++i];
+    } else if (arg == "--cache" && has_value) {
+      cache_file = argv[++i];
+    } else if (arg == "--cache-mb" && has_value) {
+      cache_size = size_t(atof(argv[++i]) * 1024 * 1024);
+    } else if (arg == "--binary-output") {
+      options.output_format = SolutionWriter::BINARY;
+    } else {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (!batch) {
+    srand(time(0));
+    Position finish(std::vector<std::vector<int>>{
+        {1, 2, 3, 4},
+        {5, 6, 7, 8},
+        {9, 10, 11, 12},
+        {13, 14, 15, Position::BLANK}});
+    Position start = finish.GetShuffled(10000);
+    std::string msg;
+    auto result = AStarSearcher().Search(
+        start, finish, std::numeric_limits<int>::max(), msg);
+    std::cout << "Solution length: " << result.size() << std::endl;
+    return 0;
+  }
+  if (options.threads <= 0 || options.node_limit <= 0 ||
+      options.search_threads <= 0 || !(options.weight >= 1) ||
+      options.search_threads > HDAStarSearcher::MAX_THREADS) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  PatternDatabase database;
+  std::unique_ptr<Heuristic> heuristic;
+  if (heuristic_name == "linear") {
+    heuristic.reset(new LinearConflictHeuristic());
+  } else if (heuristic_name == "wd") {
+    heuristic.reset(new WalkingDistanceHeuristic());
+  } else if (heuristic_name.compare(0, 4, "pdb:") == 0) {
+    std::string msg;
+    if (!database.Load(heuristic_name.substr(4), msg)) {
+      std::cerr << msg << std::endl;
+      return 1;
+    }
+    heuristic.reset(new PatternDatabaseHeuristic(database));
+  } else if (heuristic_name != "manhattan") {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  options.heuristic = heuristic.get();
+  // База шаблонов не симметрична, поэтому при --symmetry к ней добавляются
+  // просмотры отраженных позиций.
+  std::unique_ptr<Heuristic> symmetric;
+  if (options.symmetry && heuristic_name.compare(0, 4, "pdb:") == 0) {
+    symmetric.reset(new SymmetricHeuristic(*heuristic));
+    options.heuristic = symmetric.get();
+  }
+  DistanceTable table;
+  if (!table_file.empty()) {
+    std::string msg;
+    if (!table.Load(table_file, msg)) {
+      std::cerr << msg << std::endl;
+      return 1;
+    }
+    options.table = &table;
+  }
+  SolutionCache cache;
+  if (!cache_file.empty()) {
+    std::string msg;
+    if (!cache.Open(cache_file, cache_size, msg)) {
+      std::cerr << msg << std::endl;
+      return 1;
+    }
+    options.cache = &cache;
+  }
 
-int main() {
-  srand(time(0));
-  Position finish(std::vector<std::vector<int>>{
-      {1, 2, 3, 4},
-      {5, 6, 7, 8},
-      {9, 10, 11, 12},
-      {13, 14, 15, Position::BLANK}});
-  Position start = finish.GetShuffled(10000);
-  std::string msg;
-  auto result = AStarSearcher().Search(
-      start, finish, std::numeric_limits<int>::max(), msg);
-  std::cout << "Solution length: " << result.size() << std::endl;
+  if (hints) {
+    if (input_file.empty()) {
+      SolveHints(std::cin, std::cout, options);
+      return 0;
+    }
+    std::ifstream input(input_file.c_str());
+    if (!input) {
+      std::cerr << "Can't open " << input_file << std::endl;
+      return 1;
+    }
+    SolveHints(input, std::cout, options);
+  } else if (input_file.empty()) {
+    SolveBatch(std::cin, std::cout, options);
+  } else {
+    std::ifstream input(input_file.c_str(), std::ios::binary);
+    if (!input) {
+      std::cerr << "Can't open " << input_file << std::endl;
+      return 1;
+    }
+    SolveBatch(input, std::cout, options);
+  }
+  return 0;
 }
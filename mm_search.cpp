@@ -0,0 +1,260 @@
+#include "mm_search.h"
+#include "reachability.h"
+#include <algorithm>
+
+namespace {
+
+// Приоритет вершины в очереди стороны.
+int Priority( int cost, int h) {
+    return std::max( cost + h, 2 * cost);
+}
+
+} // namespace
+
+void MMSearcher::Histogram::Add( int value) {
+    if ( size_t( value) >= counts_.size() ) {
+        counts_.resize( value + 1, 0);
+    }
+    ++counts_[value];
+    min_ = std::min( min_, size_t( value));
+    ++size_;
+    return;
+}
+
+int MMSearcher::Histogram::Min() {
+    while ( !counts_[min_] ) {
+        ++min_;
+    }
+    return int( min_);
+}
+
+void MMSearcher::Histogram::Clear() {
+    std::fill( counts_.begin(), counts_.end(), 0);
+    min_ = 0;
+    size_ = 0;
+    return;
+}
+
+MMSearcher::MMSearcher()
+    : reuse_arena_( false), heuristic_( 0), time_limit_( 0), control_( 0), interrupted_( NOT_STOPPED),
+      best_length_( INT_MAX), lower_bound_( 0) {
+    meet_[SearchStats::SOURCE] = meet_[SearchStats::GOAL] = NO_NODE;
+}
+
+void MMSearcher::Open( Frontier& frontier, NodeIndex vertex) {
+    Vertex& current = frontier.arena[vertex];
+    current.heuristic = Priority( current.cost, current.h);
+    frontier.opened_set.Insert( vertex);
+    frontier.costs.Add( current.cost);
+    frontier.estimates.Add( current.cost + current.h);
+    return;
+}
+
+void MMSearcher::Close( Frontier& frontier, NodeIndex vertex) {
+    const Vertex& current = frontier.arena[vertex];
+    frontier.costs.Remove( current.cost);
+    frontier.estimates.Remove( current.cost + current.h);
+    return;
+}
+
+int MMSearcher::CurrentLowerBound() {
+    Frontier& source = sides_[SearchStats::SOURCE];
+    Frontier& goal = sides_[SearchStats::GOAL];
+    int bound = std::min( source.opened_set.MinHeuristic(), goal.opened_set.MinHeuristic());
+    bound = std::max( bound, std::max( source.estimates.Min(), goal.estimates.Min()));
+    // Ребра единичной стоимости: пути между очередями не короче одного хода.
+    return std::max( bound, source.costs.Min() + goal.costs.Min() + 1);
+}
+
+void MMSearcher::Expand( SearchStats::Side side) {
+    Frontier& frontier = sides_[side];
+    Frontier& other = sides_[SearchStats::SIDE_COUNT - 1 - side];
+    SideStats& stats = stats_.sides[side];
+    ++stats.expanded;
+    NodeIndex current = frontier.opened_set.ExtractMin();
+    Close( frontier, current);
+    Position position = frontier.arena[current].position;
+    Position::MoveList moves;
+    {
+        ProfileScope scope( stats.move_generation_seconds);
+        position.GetPossibleMoves( neighbors_, moves);
+    }
+    stats.generated += moves.Size();
+    int cost = frontier.arena[current].cost + 1;
+    for ( int index = 0; index < moves.Size(); ++index ) {
+        const Position::Move& move = moves[index];
+        position.Swap( move.from, move.to);
+        NodeIndex next;
+        {
+            ProfileScope scope( stats.lookup_seconds);
+            next = frontier.pool.Find( position);
+        }
+        if ( next == NO_NODE ) {
+            int h;
+            {
+                ProfileScope scope( stats.heuristic_seconds);
+                h = frontier.heuristic->UpdateDistance( position, frontier.arena[current].h, move.from, move.to);
+            }
+            ++stats.heuristic_evaluations;
+            next = frontier.arena.Allocate( position, cost, h, 0, current);
+            frontier.pool.Insert( next);
+            Open( frontier, next);
+        } else {
+            ++stats.duplicates;
+            if ( cost >= frontier.arena[next].cost ) {
+                position.Swap( move.from, move.to);
+                continue;
+            }
+            // Приоритет max(f, 2g) не монотонен по порядку раскрытия, поэтому
+            // улучшенная вершина возвращается в очередь, даже если уже раскрыта.
+            ++stats.reopened;
+            if ( frontier.opened_set.Contains( next) ) {
+                frontier.opened_set.Remove( next);
+                Close( frontier, next);
+            }
+            frontier.arena[next].cost = cost;
+            frontier.arena[next].parent = current;
+            Open( frontier, next);
+        }
+        NodeIndex meet;
+        {
+            ProfileScope scope( stats.lookup_seconds);
+            meet = other.pool.Find( position);
+        }
+        if ( (meet != NO_NODE) && (cost + other.arena[meet].cost < best_length_) ) {
+            best_length_ = cost + other.arena[meet].cost;
+            meet_[side] = next;
+            meet_[SearchStats::SIDE_COUNT - 1 - side] = meet;
+        }
+        position.Swap( move.from, move.to);
+    }
+    stats.peak_opened = std::max( stats.peak_opened, frontier.opened_set.Size());
+    return;
+}
+
+void MMSearcher::Report() {
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    progress_( stats_);
+    return;
+}
+
+void MMSearcher::Reset() {
+    for ( int side = 0; side < SearchStats::SIDE_COUNT; ++side ) {
+        sides_[side].opened_set.Clear();
+        sides_[side].pool.Clear();
+        sides_[side].arena.Clear();
+        sides_[side].costs.Clear();
+        sides_[side].estimates.Clear();
+    }
+    return;
+}
+
+void MMSearcher::Release() {
+    for ( int side = 0; side < SearchStats::SIDE_COUNT; ++side ) {
+        sides_[side].opened_set.Release();
+        sides_[side].pool.Release();
+        sides_[side].arena.Release();
+        sides_[side].costs = Histogram();
+        sides_[side].estimates = Histogram();
+    }
+    return;
+}
+
+size_t MMSearcher::MemoryUsage() const {
+    size_t bytes = 0;
+    for ( int side = 0; side < SearchStats::SIDE_COUNT; ++side ) {
+        bytes += sides_[side].arena.Capacity() + sides_[side].pool.Capacity();
+    }
+    return bytes;
+}
+
+std::vector<Position> MMSearcher::Search( const Position& source, const Position& goal, long long limit, std::string& error_msg) {
+    error_msg = "";
+    std::vector<Position> way;
+    stats_.Clear();
+    partial_.clear();
+    if ( !CheckReachability( source, goal, error_msg) ) {
+        return way;
+    }
+    Reset();
+    start_ = std::chrono::steady_clock::now();
+    budget_.Start( control_, limit, time_limit_);
+    interrupted_ = NOT_STOPPED;
+    neighbors_ = NeighborTable( source);
+    // Оценка каждой стороны ведется до ее цели: прямой - до goal, обратной - до source.
+    const Position* targets[SearchStats::SIDE_COUNT] = {&goal, &source};
+    const Position* roots[SearchStats::SIDE_COUNT] = {&source, &goal};
+    for ( int side = 0; side < SearchStats::SIDE_COUNT; ++side ) {
+        Frontier& frontier = sides_[side];
+        frontier.heuristic = PrepareHeuristic( heuristic_, *targets[side]);
+        int h = frontier.heuristic->Distance( *roots[side]);
+        stats_.sides[side].heuristic_evaluations = 1;
+        NodeIndex root = frontier.arena.Allocate( *roots[side], 0, h, 0, NO_NODE);
+        frontier.pool.Insert( root);
+        Open( frontier, root);
+        meet_[side] = root;
+    }
+    best_length_ = (source == goal) ? 0 : INT_MAX;
+    lower_bound_ = 0;
+    while ( !sides_[SearchStats::SOURCE].opened_set.Empty() && !sides_[SearchStats::GOAL].opened_set.Empty() ) {
+        lower_bound_ = std::max( lower_bound_, CurrentLowerBound());
+        if ( best_length_ <= lower_bound_ ) {
+            break;
+        }
+        long long expanded = stats_.Expanded();
+        if ( expanded >= budget_.NodeLimit() ) {
+            interrupted_ = NODE_LIMIT;
+            break;
+        }
+        if ( expanded && !(expanded % CHECK_PERIOD) ) {
+            if ( progress_ ) {
+                Report();
+            }
+            interrupted_ = budget_.Check( MemoryUsage());
+            if ( interrupted_ != NOT_STOPPED ) {
+                break;
+            }
+        }
+        // Раскрывается сторона с меньшим приоритетом, при равенстве - с меньшей очередью.
+        int source_priority = sides_[SearchStats::SOURCE].opened_set.MinHeuristic();
+        int goal_priority = sides_[SearchStats::GOAL].opened_set.MinHeuristic();
+        bool forward = (source_priority < goal_priority)
+            || ((source_priority == goal_priority)
+                && (sides_[SearchStats::SOURCE].opened_set.Size() <= sides_[SearchStats::GOAL].opened_set.Size()));
+        Expand( forward ? SearchStats::SOURCE : SearchStats::GOAL);
+    }
+    for ( int side = 0; side < SearchStats::SIDE_COUNT; ++side ) {
+        stats_.sides[side].closed = sides_[side].pool.Size() - sides_[side].opened_set.Size();
+    }
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    if ( interrupted_ != NOT_STOPPED ) {
+        // Найденный путь без доказательства оптимальности не возвращается.
+        error_msg = StopMessage( interrupted_);
+        const VertexArena& arena = sides_[SearchStats::SOURCE].arena;
+        for ( NodeIndex vertex = BestOpened( arena); vertex != NO_NODE; vertex = arena[vertex].parent ) {
+            partial_.push_back( arena[vertex].position);
+        }
+        std::reverse( partial_.begin(), partial_.end());
+    } else if ( best_length_ == INT_MAX ) {
+        error_msg = "No solution";
+    } else {
+        // Длина доказана нижней границей или исчерпанием очереди одной из сторон:
+        // пути через все ее вершины уже учтены в best_length_.
+        lower_bound_ = best_length_;
+        const VertexArena& source_arena = sides_[SearchStats::SOURCE].arena;
+        for ( NodeIndex vertex = meet_[SearchStats::SOURCE]; vertex != NO_NODE; vertex = source_arena[vertex].parent ) {
+            way.push_back( source_arena[vertex].position);
+        }
+        std::reverse( way.begin(), way.end());
+        const VertexArena& goal_arena = sides_[SearchStats::GOAL].arena;
+        for ( NodeIndex vertex = goal_arena[meet_[SearchStats::GOAL]].parent; vertex != NO_NODE; vertex = goal_arena[vertex].parent ) {
+            way.push_back( goal_arena[vertex].position);
+        }
+    }
+    if ( reuse_arena_ ) {
+        Reset();
+    } else {
+        Release();
+    }
+    return way;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#ifndef _MM_SEARCH_H_
+#define _MM_SEARCH_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <climits>
+#include "position.h"
+#include "heuristic.h"
+#include "search.h"
+#include "search_stats.h"
+#include "search_control.h"
+
+// Двунаправленный поиск MM ("meet in the middle"), находящий кратчайший путь.
+// Каждая сторона упорядочивает очередь по max(g + h, 2g), так что стороны
+// встречаются посередине. Поиск помнит лучшую найденную длину пути через
+// вершины, известные обеим сторонам, и останавливается, как только она не
+// больше нижней границы
+//   max( min(prmin прямой, prmin обратной), fmin прямой, fmin обратной, gmin прямой + gmin обратной + 1),
+// то есть когда ее оптимальность доказана; второй проверочный поиск не нужен.
+// Оценка должна быть допустимой.
+class MMSearcher {
+public:
+    MMSearcher();
+    // Сохранять ли память арен и таблиц между вызовами Search.
+    void SetReuseArena( bool reuse) {reuse_arena_ = reuse;}
+    // Прототип оценки для обеих сторон, как в AStarSearcher.
+    void SetHeuristic( const Heuristic* heuristic) {heuristic_ = heuristic;}
+    // Ограничение времени одного вызова Search в секундах, 0 - без ограничения.
+    void SetTimeLimit( double seconds) {time_limit_ = seconds;}
+    // Внешние ограничения и отмена, 0 - нет. Память учитывает арены и пулы обеих сторон.
+    void SetControl( const SearchControl* control) {control_ = control;}
+    long long NodesExpanded() const {return stats_.Expanded();}
+    const SearchStats& Stats() const {return stats_;}
+    // Вызывается раз в 1024 раскрытых вершины обеих сторон.
+    void SetProgress( const ProgressCallback& progress) {progress_ = progress;}
+    // limit - ограничение на суммарное число раскрытых вершин обеих сторон.
+    std::vector<Position> Search( const Position& source, const Position& goal, long long limit, std::string& error_msg);
+    // Нижняя граница длины пути, доказанная к концу последнего Search; для
+    // найденного пути равна его длине.
+    int LowerBound() const {return lower_bound_;}
+    // Путь от начальной позиции до вершины очереди прямой стороны с
+    // наименьшей оценкой, если последний Search прерван; иначе пуст.
+    const std::vector<Position>& BestPartial() const {return partial_;}
+private:
+    MMSearcher( const MMSearcher&);
+    MMSearcher& operator=( const MMSearcher&);
+    // Число вершин очереди для каждого значения g или f.
+    class Histogram {
+    public:
+        Histogram() : min_( 0), size_( 0) {}
+        void Add( int value);
+        void Remove( int value) {--counts_[value]; --size_;}
+        // Наименьшее значение непустой гистограммы.
+        int Min();
+        void Clear();
+    private:
+        std::vector<size_t> counts_;
+        size_t min_;
+        size_t size_;
+    };
+    // Одна сторона поиска.
+    struct Frontier {
+        Frontier() : pool( arena), opened_set( arena) {}
+        VertexArena arena;
+        VertexPool pool;
+        OpenedSet opened_set;
+        Histogram costs;
+        Histogram estimates;
+        std::unique_ptr<Heuristic> heuristic;
+    };
+    void Open( Frontier& frontier, NodeIndex vertex);
+    void Close( Frontier& frontier, NodeIndex vertex);
+    // Нижняя граница длины пути по очередям обеих сторон; обе не пусты.
+    int CurrentLowerBound();
+    void Expand( SearchStats::Side side);
+    void Report();
+    void Reset();
+    void Release();
+    size_t MemoryUsage() const;
+    bool reuse_arena_;
+    const Heuristic* heuristic_;
+    double time_limit_;
+    const SearchControl* control_;
+    SearchBudget budget_;
+    StopReason interrupted_;
+    std::vector<Position> partial_;
+    SearchStats stats_;
+    ProgressCallback progress_;
+    std::chrono::steady_clock::time_point start_;
+    NeighborTable neighbors_;
+    Frontier sides_[SearchStats::SIDE_COUNT];
+    // Длина лучшего найденного пути (INT_MAX - нет) и его вершины встречи на каждой стороне.
+    int best_length_;
+    NodeIndex meet_[SearchStats::SIDE_COUNT];
+    int lower_bound_;
+};
+
+#endif /* _MM_SEARCH_H_ */
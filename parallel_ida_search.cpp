@@ -0,0 +1,210 @@
+#include "parallel_ida_search.h"
+#include "reachability.h"
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <climits>
+
+const int ParallelIDAStarSearcher::ITEMS_PER_THREAD = 16;
+
+ParallelIDAStarSearcher::ParallelIDAStarSearcher()
+    : prototype_( 0), threads_( 1), time_limit_( 0), nodes_( 0), limit_( 0), control_( 0), cancel_( INT_MAX), shared_nodes_( 0),
+      next_threshold_( INT_MAX), found_( false), interrupted_( NOT_STOPPED) {
+    SetThreads( std::max( 1, int( std::thread::hardware_concurrency())));
+}
+
+void ParallelIDAStarSearcher::SetThreads( int threads) {
+    if ( threads < 1 ) {
+        throw std::invalid_argument( "threads");
+    }
+    threads_ = threads;
+    return;
+}
+
+int ParallelIDAStarSearcher::Split( int cost, int h, int threshold, int depth) {
+    if ( cost + h > threshold ) {
+        return cost + h;
+    }
+    if ( (cost == depth) || (!h && (position_ == goal_)) ) {
+        items_.push_back( Item());
+        items_.back().path = path_;
+        items_.back().h = h;
+        return INT_MAX;
+    }
+    ++nodes_;
+    split_stats_.peak_opened = std::max( split_stats_.peak_opened, size_t( cost));
+    Position::MoveList moves;
+    position_.GetPossibleMoves( neighbors_, moves);
+    int next_threshold = INT_MAX;
+    for ( int index = 0; index < moves.Size(); ++index ) {
+        const Position::Move& move = moves[index];
+        if ( !path_.empty() && (path_.back() == move) ) {
+            continue;
+        }
+        position_.Swap( move.from, move.to);
+        path_.push_back( move);
+        ++split_stats_.generated;
+        int result = Split( cost + 1, heuristic_->UpdateDistance( position_, h, move.from, move.to), threshold, depth);
+        path_.pop_back();
+        position_.Swap( move.from, move.to);
+        next_threshold = std::min( next_threshold, result);
+    }
+    return next_threshold;
+}
+
+void ParallelIDAStarSearcher::RunItem( int worker, int item, int threshold) {
+    if ( cancel_.load() < item ) {
+        return;
+    }
+    IDAStarSearcher& searcher = *workers_[worker];
+    const Item& task = items_[item];
+    searcher.position_ = source_;
+    for ( size_t index = 0; index < task.path.size(); ++index ) {
+        searcher.position_.Swap( task.path[index].from, task.path[index].to);
+    }
+    searcher.path_ = task.path;
+    if ( searcher.moves_.size() <= size_t( threshold) ) {
+        searcher.moves_.resize( threshold + 1);
+    }
+    searcher.nodes_ = 0;
+    searcher.limit_ = std::max( 0LL, limit_ - shared_nodes_.load());
+    searcher.interrupted_ = NOT_STOPPED;
+    searcher.cancelled_ = false;
+    searcher.item_ = item;
+    int result = searcher.DepthSearch( int( task.path.size()), task.h, threshold);
+    shared_nodes_.fetch_add( std::min( searcher.nodes_, searcher.limit_));
+
+    std::lock_guard<std::mutex> lock( result_mutex_);
+    if ( result == IDAStarSearcher::FOUND ) {
+        if ( !found_ || (item < cancel_) ) {
+            found_ = true;
+            cancel_ = item;
+            solution_ = searcher.path_;
+        }
+    } else if ( (searcher.interrupted_ != NOT_STOPPED) || (searcher.nodes_ > searcher.limit_) ) {
+        interrupted_ = (searcher.interrupted_ != NOT_STOPPED) ? searcher.interrupted_ : NODE_LIMIT;
+        cancel_ = found_ ? cancel_.load() : -1;
+    } else if ( !searcher.cancelled_ ) {
+        next_threshold_ = std::min( next_threshold_, result);
+    }
+    return;
+}
+
+void ParallelIDAStarSearcher::UpdateStats() {
+    SideStats total = split_stats_;
+    total.expanded = nodes_ + shared_nodes_;
+    for ( int worker = 0; worker < threads_; ++worker ) {
+        const SideStats& stats = workers_[worker]->stats_.sides[SearchStats::SOURCE];
+        total.generated += stats.generated;
+        total.peak_opened = std::max( total.peak_opened, stats.peak_opened);
+        total.move_generation_seconds += stats.move_generation_seconds;
+        total.heuristic_seconds += stats.heuristic_seconds;
+    }
+    // Каждая порожденная позиция оценивается один раз, плюс начальная.
+    total.heuristic_evaluations = total.generated + 1;
+    stats_.sides[SearchStats::SOURCE] = total;
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    return;
+}
+
+std::vector<Position> ParallelIDAStarSearcher::Search( const Position& source, const Position& goal, long long limit, std::string& error_msg) {
+    error_msg = "";
+    std::vector<Position> way;
+    nodes_ = 0;
+    stats_.Clear();
+    partial_.clear();
+    if ( !CheckReachability( source, goal, error_msg) ) {
+        return way;
+    }
+    if ( !pool_ || (pool_->Size() != threads_) ) {
+        pool_.reset();
+        pool_.reset( new ThreadPool( threads_));
+    }
+    while ( int( workers_.size()) < threads_ ) {
+        workers_.push_back( std::unique_ptr<IDAStarSearcher>( new IDAStarSearcher()));
+    }
+    source_ = source;
+    goal_ = goal;
+    neighbors_ = NeighborTable( source);
+    split_stats_ = SideStats();
+    start_ = std::chrono::steady_clock::now();
+    budget_.Start( control_, limit, time_limit_);
+    limit_ = budget_.NodeLimit();
+    heuristic_ = PrepareHeuristic( prototype_, goal_);
+    for ( int worker = 0; worker < threads_; ++worker ) {
+        IDAStarSearcher& searcher = *workers_[worker];
+        searcher.goal_ = goal_;
+        searcher.neighbors_ = neighbors_;
+        searcher.heuristic_ = PrepareHeuristic( prototype_, goal_);
+        searcher.budget_ = budget_;
+        searcher.cancel_ = &cancel_;
+        searcher.stats_.Clear();
+    }
+    shared_nodes_ = 0;
+    found_ = false;
+    interrupted_ = NOT_STOPPED;
+    solution_.clear();
+    int h = heuristic_->Distance( source_);
+    for ( int worker = 0; worker < threads_; ++worker ) {
+        workers_[worker]->best_h_ = h;
+        workers_[worker]->best_path_.clear();
+    }
+    int threshold = h;
+    while ( !found_ && (interrupted_ == NOT_STOPPED) ) {
+        // Глубина разбиения растет, пока задач меньше ITEMS_PER_THREAD на поток.
+        // В счетчиках остается только последнее разбиение.
+        int next_threshold = INT_MAX;
+        long long split_nodes = nodes_;
+        SideStats split_stats = split_stats_;
+        for ( int depth = 1; ; ++depth ) {
+            nodes_ = split_nodes;
+            split_stats_ = split_stats;
+            items_.clear();
+            position_ = source_;
+            path_.clear();
+            next_threshold = Split( 0, h, threshold, depth);
+            if ( items_.empty() || (int( items_.size()) >= ITEMS_PER_THREAD * threads_) || (depth >= threshold) ) {
+                break;
+            }
+        }
+        cancel_ = INT_MAX;
+        next_threshold_ = next_threshold;
+        // Задачи ставятся с конца: поток берет из своей очереди последнюю
+        // поставленную, так что задачи с меньшими номерами выполняются раньше.
+        for ( int item = int( items_.size()) - 1; item >= 0; --item ) {
+            pool_->Submit( [this, item, threshold]( int worker) {RunItem( worker, item, threshold);});
+        }
+        pool_->Wait();
+        if ( found_ || (next_threshold_ == INT_MAX) ) {
+            break;
+        }
+        if ( shared_nodes_ + nodes_ > limit_ ) {
+            interrupted_ = NODE_LIMIT;
+        } else {
+            interrupted_ = budget_.Check( 0);
+        }
+        threshold = next_threshold_;
+        if ( progress_ ) {
+            UpdateStats();
+            progress_( stats_);
+        }
+    }
+    UpdateStats();
+    nodes_ += shared_nodes_;
+    if ( !found_ ) {
+        if ( interrupted_ != NOT_STOPPED ) {
+            error_msg = StopMessage( interrupted_);
+            int best = 0;
+            for ( int worker = 1; worker < threads_; ++worker ) {
+                if ( workers_[worker]->best_h_ < workers_[best]->best_h_ ) {
+                    best = worker;
+                }
+            }
+            partial_ = IDAStarSearcher::Replay( source_, workers_[best]->best_path_);
+        } else {
+            error_msg = "No solution";
+        }
+        return way;
+    }
+    return IDAStarSearcher::Replay( source_, solution_);
+}
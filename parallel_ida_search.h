@@ -0,0 +1,94 @@
+#pragma once
+#ifndef _PARALLEL_IDA_SEARCH_H_
+#define _PARALLEL_IDA_SEARCH_H_
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include "position.h"
+#include "heuristic.h"
+#include "search_stats.h"
+#include "search_control.h"
+#include "ida_search.h"
+#include "thread_pool.h"
+
+// Параллельный IDA*. На каждом пороге дерево поиска обходится до небольшой
+// глубины, вершины этой глубины становятся задачами пула потоков (ThreadPool с
+// перехватом задач). У каждого потока свой IDAStarSearcher со своей копией
+// позиции и оценки. Порог переходит к следующему только после всех задач,
+// поэтому длина решения минимальна. Из решений одного порога выбирается решение
+// задачи с наименьшим номером (первое в порядке обычного IDA*), и задачи с
+// большими номерами прерываются, так что и сам путь не зависит от числа потоков.
+class ParallelIDAStarSearcher {
+public:
+    ParallelIDAStarSearcher();
+    void SetThreads( int threads);
+    void SetHeuristic( const Heuristic* heuristic) {prototype_ = heuristic;}
+    // Ограничение времени одного вызова Search в секундах, 0 - без ограничения.
+    void SetTimeLimit( double seconds) {time_limit_ = seconds;}
+    // Внешние ограничения и отмена, 0 - нет; проверяются каждым потоком.
+    void SetControl( const SearchControl* control) {control_ = control;}
+    long long NodesExpanded() const {return nodes_;}
+    // Статистика последнего вызова Search, сумма по разбиению и потокам.
+    const SearchStats& Stats() const {return stats_;}
+    // Вызывается из вызвавшего Search потока после каждого порога.
+    void SetProgress( const ProgressCallback& progress) {progress_ = progress;}
+    // limit - ограничение на суммарное число раскрытых вершин.
+    std::vector<Position> Search( const Position& source, const Position& goal, long long limit, std::string& error_msg);
+    // Путь до раскрытой вершины с наименьшей оценкой среди всех потоков,
+    // если последний Search прерван ограничением или отменой; иначе пуст.
+    const std::vector<Position>& BestPartial() const {return partial_;}
+    // Задач на поток, которых стремится достичь разбиение.
+    const static int ITEMS_PER_THREAD;
+private:
+    ParallelIDAStarSearcher( const ParallelIDAStarSearcher&);
+    ParallelIDAStarSearcher& operator=( const ParallelIDAStarSearcher&);
+    struct Item {
+        std::vector<Position::Move> path;
+        int h;
+    };
+    // Обход до глубины depth с отсечением по threshold; вершины глубины depth
+    // и целевые вершины становятся задачами. Возвращает наименьшую оценку
+    // отсеченной вершины.
+    int Split( int cost, int h, int threshold, int depth);
+    void RunItem( int worker, int item, int threshold);
+    // Собирает stats_ из счетчиков разбиения и потоков; потоки должны простаивать.
+    void UpdateStats();
+    const Heuristic* prototype_;
+    std::unique_ptr<Heuristic> heuristic_;
+    int threads_;
+    double time_limit_;
+    long long nodes_;
+    long long limit_;
+    const SearchControl* control_;
+    SearchBudget budget_;
+    std::vector<Position> partial_;
+    SearchStats stats_;
+    // Счетчики разбиения.
+    SideStats split_stats_;
+    ProgressCallback progress_;
+    std::chrono::steady_clock::time_point start_;
+    Position source_;
+    Position goal_;
+    NeighborTable neighbors_;
+    // Состояние разбиения: текущая позиция и ходы до нее.
+    Position position_;
+    std::vector<Position::Move> path_;
+    std::vector<Item> items_;
+    std::unique_ptr<ThreadPool> pool_;
+    std::vector< std::unique_ptr<IDAStarSearcher> > workers_;
+    // Номер задачи с найденным решением (или -1 для остановки всех задач).
+    std::atomic<int> cancel_;
+    std::atomic<long long> shared_nodes_;
+    // Результаты порога, под result_mutex_.
+    std::mutex result_mutex_;
+    std::vector<Position::Move> solution_;
+    int next_threshold_;
+    bool found_;
+    StopReason interrupted_;
+};
+
+#endif /* _PARALLEL_IDA_SEARCH_H_ */
@@ -0,0 +1,451 @@
+#include "pattern_database.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const uint32_t PatternDatabase::VERSION = 1;
+
+namespace {
+
+const char MAGIC[8] = {'1', '5', 'P', 'D', 'B', '\n', 0, 0};
+const int MAX_CELLS = 32;
+const unsigned char UNKNOWN = 0xFF;
+
+// Число размещений count различных клеток из cells.
+uint64_t Arrangements( int cells, int count) {
+    uint64_t result = 1;
+    for ( int i = 0; i < count; ++i ) {
+        result *= uint64_t( cells - i);
+    }
+    return result;
+}
+
+// Номер размещения клеток positions[0..count) из cells, последняя клетка -
+// младший разряд. Отбрасывание младшего разряда дает номер размещения первых
+// count - 1 клеток.
+uint64_t Rank( const int* positions, int count, int cells) {
+    uint64_t result = 0;
+    uint32_t used = 0;
+    for ( int i = 0; i < count; ++i ) {
+        int digit = positions[i] - __builtin_popcount( used & ((1u << positions[i]) - 1));
+        result = result * uint64_t( cells - i) + uint64_t( digit);
+        used |= 1u << positions[i];
+    }
+    return result;
+}
+
+void Unrank( uint64_t rank, int count, int cells, int* positions) {
+    int digits[MAX_CELLS];
+    for ( int i = count - 1; i >= 0; --i ) {
+        digits[i] = int( rank % uint64_t( cells - i));
+        rank /= uint64_t( cells - i);
+    }
+    uint32_t used = 0;
+    for ( int i = 0; i < count; ++i ) {
+        int cell = -1;
+        for ( int skip = digits[i]; skip >= 0; --skip ) {
+            do {
+                ++cell;
+            } while ( (used >> cell) & 1 );
+        }
+        positions[i] = cell;
+        used |= 1u << cell;
+    }
+    return;
+}
+
+// Клетки из free, связанные с клеткой cell через клетки из free.
+uint32_t Fill( uint32_t free, const uint32_t* adjacent, int cell) {
+    uint32_t region = 1u << cell;
+    for ( uint32_t frontier = region; frontier; ) {
+        uint32_t added = adjacent[__builtin_ctz( frontier)] & free & ~region;
+        frontier &= frontier - 1;
+        region |= added;
+        frontier |= added;
+    }
+    return region;
+}
+
+// Номер связной области free, содержащей cell, среди областей free по
+// возрастанию их младшей клетки.
+int Component( uint32_t free, const uint32_t* adjacent, int cell) {
+    int index = 0;
+    for ( uint32_t rest = free; ; ++index ) {
+        uint32_t region = Fill( rest, adjacent, __builtin_ctz( rest));
+        if ( (region >> cell) & 1 ) {
+            return index;
+        }
+        rest &= ~region;
+    }
+}
+
+uint32_t Occupied( const int* positions, int count) {
+    uint32_t result = 0;
+    for ( int slot = 0; slot < count; ++slot ) {
+        result |= 1u << positions[slot];
+    }
+    return result;
+}
+
+template <class T>
+bool Read( const unsigned char*& data, const unsigned char* end, T& value) {
+    if ( size_t( end - data) < sizeof( T) ) {
+        return false;
+    }
+    std::memcpy( &value, data, sizeof( T));
+    data += sizeof( T);
+    return true;
+}
+
+template <class T>
+bool Write( FILE* file, const T& value) {
+    return fwrite( &value, sizeof( T), 1, file) == 1;
+}
+
+} // namespace
+
+PatternDatabase::PatternDatabase()
+    : mapping_( 0), mapping_size_( 0) {
+}
+
+PatternDatabase::~PatternDatabase() {
+    Clear();
+}
+
+void PatternDatabase::Clear() {
+    groups_.clear();
+    tile_group_.clear();
+    tile_slot_.clear();
+    if ( mapping_ ) {
+        munmap( mapping_, mapping_size_);
+        mapping_ = 0;
+        mapping_size_ = 0;
+    }
+    return;
+}
+
+std::vector< std::vector<int> > PatternDatabase::DefaultPartition( const Position& goal, int group_size) {
+    std::vector< std::vector<int> > result;
+    for ( int cell = 0; cell < goal.Height() * goal.Width(); ++cell ) {
+        int value = goal.GetField( cell);
+        if ( (value == Position::BLANK) || (value == Position::STONE) ) {
+            continue;
+        }
+        if ( result.empty() || (int( result.back().size()) >= group_size) ) {
+            result.push_back( std::vector<int>());
+        }
+        result.back().push_back( value);
+    }
+    return result;
+}
+
+void PatternDatabase::Build( const Position& goal, const std::vector< std::vector<int> >& partition) {
+    Clear();
+    goal_ = goal;
+    if ( Cells() > MAX_CELLS ) {
+        throw std::invalid_argument( "goal");
+    }
+    int blanks = 0;
+    std::vector<int> seen;
+    for ( int cell = 0; cell < Cells(); ++cell ) {
+        int value = goal.GetField( cell);
+        if ( value == Position::BLANK ) {
+            ++blanks;
+        } else if ( value != Position::STONE ) {
+            if ( (value > Position::MAX_PACKED_VALUE) || std::count( seen.begin(), seen.end(), value) ) {
+                throw std::invalid_argument( "goal");
+            }
+            seen.push_back( value);
+        }
+    }
+    if ( blanks != 1 ) {
+        throw std::invalid_argument( "goal");
+    }
+    groups_.resize( partition.size());
+    for ( size_t group = 0; group < partition.size(); ++group ) {
+        groups_[group].tiles = partition[group];
+    }
+    Index();
+    for ( size_t group = 0; group < groups_.size(); ++group ) {
+        BuildGroup( groups_[group]);
+    }
+    return;
+}
+
+void PatternDatabase::Index() {
+    tile_group_.assign( Position::MAX_PACKED_VALUE + 1, -1);
+    tile_slot_.assign( Position::MAX_PACKED_VALUE + 1, -1);
+    for ( size_t group = 0; group < groups_.size(); ++group ) {
+        const std::vector<int>& tiles = groups_[group].tiles;
+        if ( tiles.empty() || (tiles.size() >= size_t( Cells())) ) {
+            throw std::invalid_argument( "partition");
+        }
+        for ( size_t slot = 0; slot < tiles.size(); ++slot ) {
+            int value = tiles[slot];
+            if ( (value <= 0) || (value > Position::MAX_PACKED_VALUE) || (tile_group_[value] != -1) ) {
+                throw std::invalid_argument( "partition");
+            }
+            tile_group_[value] = int( group);
+            tile_slot_[value] = int( slot);
+        }
+    }
+    return;
+}
+
+// Поиск в ширину по состояниям (размещение фишек группы, связная область
+// свободных клеток, в которой стоит пустое место). Внутри области пустое место
+// ходит бесплатно, поэтому ход - это сдвиг фишки группы на клетку области.
+// Значение размещения - глубина, на которой оно встретилось впервые, то есть
+// минимум по положениям пустого места. Таблица хранится без пустого места, а
+// пройденные области отмечаются битами по номеру области среди областей
+// размещения (по возрастанию младшей клетки): пройденные, текущий и следующий
+// уровни. Уровни выбираются проходом по маскам, без очереди.
+void PatternDatabase::BuildGroup( Group& group) {
+    int cells = Cells();
+    int count = int( group.tiles.size());
+    int positions[MAX_CELLS];
+    uint32_t all = 0;
+    for ( int cell = 0; cell < cells; ++cell ) {
+        if ( goal_.GetField( cell) != Position::STONE ) {
+            all |= 1u << cell;
+        }
+        for ( int slot = 0; slot < count; ++slot ) {
+            if ( goal_.GetField( cell) == group.tiles[slot] ) {
+                positions[slot] = cell;
+            }
+        }
+        if ( goal_.GetField( cell) == Position::BLANK ) {
+            positions[count] = cell;
+        }
+    }
+    NeighborTable neighbors( goal_);
+    uint32_t adjacent[MAX_CELLS];
+    for ( int cell = 0; cell < cells; ++cell ) {
+        adjacent[cell] = 0;
+        for ( int i = 0; i < neighbors.Count( cell); ++i ) {
+            adjacent[cell] |= 1u << neighbors.Neighbors( cell)[i];
+        }
+    }
+    group.size = Arrangements( cells, count);
+    // Областей не больше, чем свободных клеток.
+    size_t stride = (size_t( __builtin_popcount( all)) - size_t( count) + 7) / 8;
+    std::vector<unsigned char> visited( group.size * stride, 0);
+    std::vector<unsigned char> current( group.size * stride, 0);
+    std::vector<unsigned char> next( group.size * stride, 0);
+    group.storage.assign( group.size, UNKNOWN);
+    uint64_t start = Rank( positions, count, cells);
+    int component = Component( all & ~Occupied( positions, count), adjacent, positions[count]);
+    group.storage[start] = 0;
+    visited[start * stride + component / 8] |= (unsigned char)( 1u << (component % 8));
+    current[start * stride + component / 8] |= (unsigned char)( 1u << (component % 8));
+    for ( int depth = 0; ; ++depth ) {
+        bool reached = false;
+        for ( uint64_t state = 0; state < group.size; ++state ) {
+            const unsigned char* marks = &current[state * stride];
+            bool any = false;
+            for ( size_t i = 0; i < stride; ++i ) {
+                any = any || marks[i];
+            }
+            if ( !any ) {
+                continue;
+            }
+            Unrank( state, count, cells, positions);
+            uint32_t free = all & ~Occupied( positions, count);
+            uint32_t rest = free;
+            for ( int index = 0; rest; ++index ) {
+                uint32_t area = Fill( rest, adjacent, __builtin_ctz( rest));
+                rest &= ~area;
+                if ( !((marks[index / 8] >> (index % 8)) & 1) ) {
+                    continue;
+                }
+                for ( int slot = 0; slot < count; ++slot ) {
+                    int from = positions[slot];
+                    for ( uint32_t targets = adjacent[from] & area; targets; targets &= targets - 1 ) {
+                        int cell = __builtin_ctz( targets);
+                        positions[slot] = cell;
+                        uint64_t neighbor = Rank( positions, count, cells);
+                        int place = Component( (free & ~(1u << cell)) | (1u << from), adjacent, from);
+                        unsigned char bit = (unsigned char)( 1u << (place % 8));
+                        unsigned char& seen = visited[neighbor * stride + place / 8];
+                        if ( !(seen & bit) ) {
+                            if ( depth + 1 >= UNKNOWN ) {
+                                throw std::overflow_error( "Pattern database depth");
+                            }
+                            seen |= bit;
+                            next[neighbor * stride + place / 8] |= bit;
+                            group.storage[neighbor] = std::min( group.storage[neighbor], (unsigned char)( depth + 1));
+                            reached = true;
+                        }
+                    }
+                    positions[slot] = from;
+                }
+            }
+        }
+        if ( !reached ) {
+            break;
+        }
+        current.swap( next);
+        std::fill( next.begin(), next.end(), (unsigned char)( 0));
+    }
+    // Недостижимые размещения встречаются только в неразрешимых позициях.
+    std::replace( group.storage.begin(), group.storage.end(), UNKNOWN, (unsigned char)( 0));
+    group.table = &group.storage[0];
+    return;
+}
+
+bool PatternDatabase::Save( const std::string& file_name, std::string& error_msg) const {
+    error_msg = "";
+    FILE* file = fopen( file_name.c_str(), "wb");
+    if ( !file ) {
+        error_msg = "Can't open " + file_name;
+        return false;
+    }
+    bool ok = (fwrite( MAGIC, sizeof( MAGIC), 1, file) == 1) && Write( file, VERSION)
+        && Write( file, uint32_t( goal_.Height())) && Write( file, uint32_t( goal_.Width()))
+        && Write( file, uint32_t( groups_.size()));
+    for ( int cell = 0; ok && (cell < Cells()); ++cell ) {
+        ok = Write( file, int32_t( goal_.GetField( cell)));
+    }
+    for ( size_t group = 0; ok && (group < groups_.size()); ++group ) {
+        ok = Write( file, uint32_t( groups_[group].tiles.size()));
+        for ( size_t slot = 0; ok && (slot < groups_[group].tiles.size()); ++slot ) {
+            ok = Write( file, int32_t( groups_[group].tiles[slot]));
+        }
+        ok = ok && Write( file, groups_[group].size);
+    }
+    for ( size_t group = 0; ok && (group < groups_.size()); ++group ) {
+        ok = fwrite( groups_[group].table, 1, size_t( groups_[group].size), file) == groups_[group].size;
+    }
+    if ( (fclose( file) != 0) || !ok ) {
+        error_msg = "Can't write " + file_name;
+        return false;
+    }
+    return true;
+}
+
+bool PatternDatabase::Load( const std::string& file_name, std::string& error_msg) {
+    error_msg = "";
+    Clear();
+    int file = open( file_name.c_str(), O_RDONLY);
+    if ( file < 0 ) {
+        error_msg = "Can't open " + file_name;
+        return false;
+    }
+    struct stat info;
+    if ( (fstat( file, &info) != 0) || (info.st_size < off_t( sizeof( MAGIC))) ) {
+        close( file);
+        error_msg = "Bad pattern database " + file_name;
+        return false;
+    }
+    mapping_size_ = size_t( info.st_size);
+    mapping_ = mmap( 0, mapping_size_, PROT_READ, MAP_SHARED, file, 0);
+    close( file);
+    if ( mapping_ == MAP_FAILED ) {
+        mapping_ = 0;
+        error_msg = "Can't map " + file_name;
+        return false;
+    }
+    const unsigned char* data = static_cast<const unsigned char*>( mapping_);
+    const unsigned char* end = data + mapping_size_;
+    uint32_t version = 0, height = 0, width = 0, group_count = 0;
+    bool ok = !std::memcmp( data, MAGIC, sizeof( MAGIC));
+    data += sizeof( MAGIC);
+    ok = ok && Read( data, end, version) && (version == VERSION)
+        && Read( data, end, height) && Read( data, end, width) && Read( data, end, group_count)
+        && (height > 0) && (width > 0) && (height * width <= uint32_t( MAX_CELLS));
+    if ( ok ) {
+        vector<int> cells( height * width);
+        for ( size_t cell = 0; ok && (cell < cells.size()); ++cell ) {
+            int32_t value = 0;
+            ok = Read( data, end, value);
+            cells[cell] = value;
+        }
+        goal_ = Position( int( height), int( width), cells);
+    }
+    if ( ok ) {
+        groups_.resize( group_count);
+    }
+    for ( size_t group = 0; ok && (group < groups_.size()); ++group ) {
+        uint32_t count = 0;
+        ok = Read( data, end, count) && (count < height * width);
+        for ( uint32_t slot = 0; ok && (slot < count); ++slot ) {
+            int32_t value = 0;
+            ok = Read( data, end, value);
+            groups_[group].tiles.push_back( value);
+        }
+        ok = ok && Read( data, end, groups_[group].size)
+            && (groups_[group].size == Arrangements( int( height * width), int( count)));
+    }
+    for ( size_t group = 0; ok && (group < groups_.size()); ++group ) {
+        ok = uint64_t( end - data) >= groups_[group].size;
+        groups_[group].table = data;
+        data += ok ? groups_[group].size : 0;
+    }
+    if ( ok ) {
+        try {
+            Index();
+        } catch ( const std::invalid_argument&) {
+            ok = false;
+        }
+    }
+    if ( !ok ) {
+        Clear();
+        error_msg = "Bad pattern database " + file_name;
+        return false;
+    }
+    return true;
+}
+
+bool PatternDatabase::Matches( const Position& goal) const {
+    return !groups_.empty() && (goal == goal_);
+}
+
+int PatternDatabase::Lookup( size_t group, const int* cells) const {
+    return groups_[group].table[Rank( cells, int( groups_[group].tiles.size()), Cells())];
+}
+
+int PatternDatabase::Distance( const Position& position) const {
+    int cells[MAX_CELLS];
+    int result = 0;
+    for ( size_t group = 0; group < groups_.size(); ++group ) {
+        for ( int cell = 0; cell < Cells(); ++cell ) {
+            int value = position.GetField( cell);
+            if ( (value > 0) && (value <= Position::MAX_PACKED_VALUE) && (tile_group_[value] == int( group)) ) {
+                cells[tile_slot_[value]] = cell;
+            }
+        }
+        result += Lookup( group, cells);
+    }
+    return result;
+}
+
+int PatternDatabase::UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const {
+    int value, old_from;
+    if ( position.GetField( move_to) != Position::BLANK ) {
+        value = position.GetField( move_to);
+        old_from = move_from;
+    } else {
+        value = position.GetField( move_from);
+        old_from = move_to;
+    }
+    if ( (value > Position::MAX_PACKED_VALUE) || (tile_group_[value] < 0) ) {
+        return old_distance;
+    }
+    int group = tile_group_[value];
+    int cells[MAX_CELLS];
+    for ( int cell = 0; cell < Cells(); ++cell ) {
+        int field = position.GetField( cell);
+        if ( (field > 0) && (field <= Position::MAX_PACKED_VALUE) && (tile_group_[field] == group) ) {
+            cells[tile_slot_[field]] = cell;
+        }
+    }
+    int new_part = Lookup( group, cells);
+    cells[tile_slot_[value]] = old_from;
+    int old_part = Lookup( group, cells);
+    return old_distance - old_part + new_part;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef _PATTERN_DATABASE_H_
+#define _PATTERN_DATABASE_H_
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include "position.h"
+
+// Аддитивная база шаблонов (disjoint pattern database) для фиксированной цели.
+// Фишки цели разбиты на непересекающиеся группы; для каждой группы хранится
+// точное число ходов фишек группы, необходимое, чтобы поставить их на места.
+// Сумма по группам - допустимая оценка расстояния до цели.
+// Таблица группы из k фишек хранит байт на размещение без пустого места
+// (минимум по его положениям), всего cells!/(cells - k)! байт: для разбиения
+// 7-8 поля 4x4 это около 58 Мб и 519 Мб. На время построения к таблице
+// добавляются три битовые маски областей пустого места того же порядка размера.
+// Поддерживаются поля до 32 клеток с одним пустым местом и различными фишками,
+// камни допускаются.
+class PatternDatabase {
+public:
+    PatternDatabase();
+    ~PatternDatabase();
+    // Строит базы обратным поиском в ширину от goal.
+    void Build( const Position& goal, const std::vector< std::vector<int> >& partition);
+    bool Save( const std::string& file_name, std::string& error_msg) const;
+    // Отображает файл в память; таблицы читаются прямо из отображения.
+    bool Load( const std::string& file_name, std::string& error_msg);
+    // true, если база построена для цели goal.
+    bool Matches( const Position& goal) const;
+    int Distance( const Position& position) const;
+    // Аналог Position::UpdateDistance: пересчитывается только группа сдвинутой фишки.
+    int UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const;
+    // Разбиение по умолчанию: фишки в порядке обхода цели, группами не больше group_size.
+    static std::vector< std::vector<int> > DefaultPartition( const Position& goal, int group_size);
+    const static uint32_t VERSION;
+private:
+    PatternDatabase( const PatternDatabase&);
+    PatternDatabase& operator=( const PatternDatabase&);
+    struct Group {
+        std::vector<int> tiles;
+        const unsigned char* table;
+        uint64_t size;
+        std::vector<unsigned char> storage;
+    };
+    void Clear();
+    void Index();
+    void BuildGroup( Group& group);
+    int Lookup( size_t group, const int* cells) const;
+    int Cells() const {return goal_.Height() * goal_.Width();}
+    Position goal_;
+    std::vector<Group> groups_;
+    // Для значения фишки - номер группы и место в ней, -1 если фишка не входит в базу.
+    std::vector<int> tile_group_;
+    std::vector<int> tile_slot_;
+    void* mapping_;
+    size_t mapping_size_;
+};
+
+#endif /* _PATTERN_DATABASE_H_ */
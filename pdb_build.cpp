@@ -0,0 +1,58 @@
+#include "position.h"
+#include "pattern_database.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Строит базу шаблонов для стандартной цели height x width (фишки по порядку,
+// пустое место в правом нижнем углу) и записывает ее в файл.
+// Разбиение задается группами через '/', фишки в группе - через ',',
+// например 1,5,6,9,10,13/7,8,11,12,14,15/2,3,4.
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0]
+              << " <file> <height> <width> [partition]" << std::endl;
+    return 1;
+  }
+  int height = atoi(argv[2]), width = atoi(argv[3]);
+  if (height <= 0 || width <= 0) {
+    std::cerr << "Bad board size" << std::endl;
+    return 1;
+  }
+  std::vector<int> cells;
+  for (int i = 1; i < height * width; ++i) {
+    cells.push_back(i);
+  }
+  cells.push_back(Position::BLANK);
+  Position goal(height, width, cells);
+  std::vector<std::vector<int>> partition;
+  if (argc > 4) {
+    std::stringstream groups(argv[4]);
+    std::string group;
+    while (std::getline(groups, group, '/')) {
+      std::stringstream tiles(group);
+      std::string tile;
+      partition.push_back(std::vector<int>());
+      while (std::getline(tiles, tile, ',')) {
+        partition.back().push_back(atoi(tile.c_str()));
+      }
+    }
+  } else {
+    partition = PatternDatabase::DefaultPartition(goal, 6);
+  }
+  PatternDatabase database;
+  try {
+    database.Build(goal, partition);
+  } catch (const std::exception& e) {
+    std::cerr << "Can't build pattern database: " << e.what() << std::endl;
+    return 1;
+  }
+  std::string msg;
+  if (!database.Save(argv[1], msg)) {
+    std::cerr << msg << std::endl;
+    return 1;
+  }
+  return 0;
+}
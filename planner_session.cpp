@@ -0,0 +1,195 @@
+#include "planner_session.h"
+#include "reachability.h"
+#include <set>
+#include <stdexcept>
+
+const size_t PlannerSession::DEFAULT_MEMORY_LIMIT = size_t( 256) << 20;
+
+namespace {
+
+bool DistinctTiles( const Position& position) {
+    std::set<int> values;
+    for ( int cell = 0; cell < position.Height() * position.Width(); ++cell ) {
+        int value = position.GetField( cell);
+        if ( (value > Position::BLANK) && !values.insert( value).second ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+PlannerSession::PlannerSession()
+    : metric_( true), km_( 0), memory_limit_( DEFAULT_MEMORY_LIMIT), time_limit_( 0), control_( 0), interrupted_( NOT_STOPPED), nodes_( 0),
+      pool_( arena_), opened_set_( arena_) {
+}
+
+size_t PlannerSession::MemoryUsage() const {
+    return arena_.Capacity() + pool_.Capacity() + opened_set_.Capacity();
+}
+
+void PlannerSession::Reset() {
+    opened_set_.Clear();
+    pool_.Clear();
+    arena_.Clear();
+    km_ = 0;
+    return;
+}
+
+void PlannerSession::Release() {
+    opened_set_.Release();
+    pool_.Release();
+    arena_.Release();
+    km_ = 0;
+    return;
+}
+
+void PlannerSession::Retarget( const Position& source) {
+    if ( !arena_.Size() ) {
+        heuristic_.Prepare( source);
+        source_ = source;
+        int h = heuristic_.Distance( goal_);
+        NodeIndex root = arena_.Allocate( goal_, 0, h, h, NO_NODE);
+        pool_.Insert( root);
+        opened_set_.Insert( root);
+        return;
+    }
+    if ( source == source_ ) {
+        return;
+    }
+    if ( metric_ ) {
+        // Оценка любой позиции уменьшается не больше, чем на расстояние
+        // между прежней и новой начальными позициями.
+        km_ += heuristic_.Distance( source);
+        heuristic_.Prepare( source);
+    } else {
+        heuristic_.Prepare( source);
+        Rekey();
+    }
+    source_ = source;
+    return;
+}
+
+void PlannerSession::Rekey() {
+    for ( NodeIndex index = 0; index < NodeIndex( arena_.Size()); ++index ) {
+        Vertex& vertex = arena_[index];
+        if ( !vertex.opened ) {
+            continue;
+        }
+        opened_set_.Remove( index);
+        vertex.h = heuristic_.Distance( vertex.position);
+        vertex.heuristic = vertex.cost + vertex.h + km_;
+        opened_set_.Insert( index);
+    }
+    return;
+}
+
+void PlannerSession::Expand( NodeIndex current) {
+    Position position = arena_[current].position;
+    position.GetPossibleMoves( neighbors_, moves_);
+    for ( int index = 0; index < moves_.Size(); ++index ) {
+        const Position::Move* move = &moves_[index];
+        position.Swap( move->from, move->to);
+        int cost = arena_[current].cost + 1;
+        NodeIndex next_vertex = pool_.Find( position);
+        if ( next_vertex == NO_NODE ) {
+            int h = heuristic_.UpdateDistance( position, arena_[current].h, move->from, move->to);
+            next_vertex = arena_.Allocate( position, cost, h, cost + h + km_, current);
+            pool_.Insert( next_vertex);
+            opened_set_.Insert( next_vertex);
+        } else if ( opened_set_.Contains( next_vertex) && (arena_[next_vertex].cost > cost) ) {
+            opened_set_.DecreaseKey( next_vertex, cost);
+            arena_[next_vertex].parent = current;
+        }
+        position.Swap( move->from, move->to);
+    }
+    return;
+}
+
+NodeIndex PlannerSession::Grow( const Position& source) {
+    // Дерево начато в этом вызове: его уже нельзя отбросить ради памяти.
+    bool fresh = !arena_.Size();
+    Retarget( source);
+    long long step = 0;
+    while ( !opened_set_.Empty() ) {
+        if ( nodes_ >= budget_.NodeLimit() ) {
+            interrupted_ = NODE_LIMIT;
+            return NO_NODE;
+        }
+        if ( !(++step % CHECK_PERIOD) ) {
+            if ( memory_limit_ && (MemoryUsage() > memory_limit_) ) {
+                if ( fresh ) {
+                    interrupted_ = MEMORY_LIMIT;
+                    return NO_NODE;
+                }
+                Release();
+                fresh = true;
+                Retarget( source);
+                continue;
+            }
+            interrupted_ = budget_.Check( MemoryUsage());
+            if ( interrupted_ != NOT_STOPPED ) {
+                return NO_NODE;
+            }
+        }
+        NodeIndex current = opened_set_.ExtractMin();
+        Vertex& vertex = arena_[current];
+        if ( vertex.heuristic - vertex.cost - vertex.h != km_ ) {
+            // Оценка вычислена для прежней начальной позиции, ключ - нижняя граница.
+            vertex.h = heuristic_.Distance( vertex.position);
+            int key = vertex.cost + vertex.h + km_;
+#ifdef _DEBUG
+            if ( key < vertex.heuristic ) {
+                throw std::logic_error( "Key is not a lower bound");
+            }
+#endif
+            bool stale = (key > vertex.heuristic);
+            vertex.heuristic = key;
+            if ( stale ) {
+                opened_set_.Insert( current);
+                continue;
+            }
+        }
+        ++nodes_;
+        // Закрываемая вершина раскрывается и при совпадении с source, чтобы
+        // следующие вызовы могли продолжить поиск.
+        Expand( current);
+        if ( arena_[current].position == source ) {
+            return current;
+        }
+    }
+    return NO_NODE;
+}
+
+std::vector<Position> PlannerSession::Search( const Position& source, const Position& goal, long long limit, std::string& error_msg) {
+    error_msg = "";
+    std::vector<Position> way;
+    nodes_ = 0;
+    interrupted_ = NOT_STOPPED;
+    if ( (goal != goal_) || (goal.Height() != goal_.Height()) || (goal.Width() != goal_.Width()) ) {
+        Reset();
+        goal_ = goal;
+        metric_ = DistinctTiles( goal);
+        neighbors_ = NeighborTable( goal);
+    }
+    NodeIndex vertex = pool_.Find( source);
+    if ( (vertex == NO_NODE) || opened_set_.Contains( vertex) ) {
+        if ( !CheckReachability( source, goal, error_msg) ) {
+            return way;
+        }
+        budget_.Start( control_, limit, time_limit_);
+        if ( memory_limit_ && (MemoryUsage() > memory_limit_) ) {
+            Release();
+        }
+        vertex = Grow( source);
+        if ( vertex == NO_NODE ) {
+            error_msg = (interrupted_ != NOT_STOPPED) ? StopMessage( interrupted_) : "No solution";
+            return way;
+        }
+    }
+    for ( ; vertex != NO_NODE; vertex = arena_[vertex].parent ) {
+        way.push_back( arena_[vertex].position);
+    }
+    return way;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#ifndef _PLANNER_SESSION_H_
+#define _PLANNER_SESSION_H_
+
+#include <stddef.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include "position.h"
+#include "heuristic.h"
+#include "search.h"
+#include "search_control.h"
+
+// Сеанс подсказок для одной цели и меняющейся начальной позиции, например
+// после каждого хода игрока. A* ведется от цели к текущей начальной позиции,
+// и его дерево сохраняется между вызовами Search. Закрытые вершины хранят
+// точное расстояние до цели и родителя на кратчайшем пути к ней, поэтому
+// позиция, уже закрытая деревом (на найденном пути или рядом с ним),
+// отвечается без поиска. Для остальных поиск продолжается с сохраненной
+// очереди, как в D* Lite: после смены начальной позиции ключи очереди
+// остаются нижними границами, если прибавлять к новым ключам накопленное
+// манхэттенское расстояние между последовательными начальными позициями,
+// а устаревшие ключи уточняются при извлечении.
+// Оценка - манхэттенская. При повторяющихся фишках в цели она не
+// удовлетворяет неравенству треугольника, и при смене начальной позиции
+// очередь пересчитывается целиком.
+// Дерево, превысившее ограничение памяти, отбрасывается, и поиск начинается
+// заново от цели.
+class PlannerSession {
+public:
+    PlannerSession();
+    // Ограничение памяти дерева в байтах, 0 - без ограничения.
+    void SetMemoryLimit( size_t bytes) {memory_limit_ = bytes;}
+    // Ограничение времени одного вызова Search в секундах, 0 - без ограничения.
+    void SetTimeLimit( double seconds) {time_limit_ = seconds;}
+    // Внешние ограничения и отмена, 0 - нет. Ограничение памяти из control
+    // прерывает поиск, а не отбрасывает дерево.
+    void SetControl( const SearchControl* control) {control_ = control;}
+    // Число раскрытых вершин в последнем вызове Search.
+    long long NodesExpanded() const {return nodes_;}
+    // Число вершин сохраненного дерева.
+    size_t TreeSize() const {return arena_.Size();}
+    // Занятая деревом память в байтах.
+    size_t MemoryUsage() const;
+    // Кратчайший путь от source до goal. Новая цель начинает сеанс заново.
+    // limit - ограничение на число раскрытых вершин в этом вызове; прерванный
+    // поиск сохраняет дерево, и следующий вызов продолжит его.
+    std::vector<Position> Search( const Position& source, const Position& goal, long long limit, std::string& error_msg);
+    // Забывает дерево, оставляя память для следующего поиска.
+    void Reset();
+    void Release();
+    const static size_t DEFAULT_MEMORY_LIMIT;
+private:
+    PlannerSession( const PlannerSession&);
+    PlannerSession& operator=( const PlannerSession&);
+    // Настраивает оценку на source и поправляет ключи очереди; в пустое
+    // дерево добавляет цель.
+    void Retarget( const Position& source);
+    // Пересчитывает оценки и ключи всех вершин очереди.
+    void Rekey();
+    // Раскрывает вершины, пока source не будет закрыта. NO_NODE при
+    // остановке (причина в interrupted_) или исчерпании очереди.
+    NodeIndex Grow( const Position& source);
+    // Раскрывает извлеченную из очереди вершину.
+    void Expand( NodeIndex current);
+    Position goal_;
+    Position source_;
+    // Различны ли фишки цели, то есть выполняется ли для оценки неравенство треугольника.
+    bool metric_;
+    // Оценка расстояния до source_.
+    ManhattanHeuristic heuristic_;
+    // Сумма поправок ключей за смены начальной позиции. Ключ вершины равен
+    // cost + h + km_ для оценки h, вычисленной для текущей позиции.
+    int km_;
+    size_t memory_limit_;
+    double time_limit_;
+    const SearchControl* control_;
+    SearchBudget budget_;
+    StopReason interrupted_;
+    long long nodes_;
+    NeighborTable neighbors_;
+    Position::MoveList moves_;
+    VertexArena arena_;
+    VertexPool pool_;
+    OpenedSet opened_set_;
+};
+
+#endif /* _PLANNER_SESSION_H_ */
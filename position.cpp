@@ -5,27 +5,67 @@
 #include <map>
 #include <cmath>
 #include <limits>
+#include <cstring>
 
 
 const int Position::BLANK = 0;
 const int Position::STONE = -1;
+const int Position::MAX_PACKED_VALUE = 254;
 
-Position::Position() {
+namespace {
+
+uint64_t SplitMix( uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Ключи Зобриста для упакуемых клеток: [клетка][значение + 1].
+struct ZobristTable {
+    enum { CELLS = 32, VALUES = 256 };
+    ZobristTable() {
+        for ( int cell = 0; cell < CELLS; ++cell ) {
+            for ( int value = 0; value < VALUES; ++value ) {
+                keys[cell][value] = SplitMix( (uint64_t( cell) << 32) | uint32_t( value - 1));
+            }
+        }
+    }
+    uint64_t keys[CELLS][VALUES];
+};
+
+const ZobristTable& Zobrist() {
+    static const ZobristTable table;
+    return table;
+}
+
+} // namespace
+
+// Ключ не зависит от способа хранения поля, чтобы равные позиции
+// имели равные хеши.
+uint64_t Position::ZobristKey( int index, int value) {
+    if ( (index < ZobristTable::CELLS) && (value <= MAX_PACKED_VALUE) ) {
+        return Zobrist().keys[index][value + 1];
+    }
+    return SplitMix( (uint64_t( index) << 32) | uint32_t( value));
+}
+
+Position::Position()
+    : height_( 0), width_( 0), hash_( 0), blank_count_( 0) {
+    std::memset( words_, 0, sizeof( words_));
 }
 
-Position::Position( int height, int width)
-    : height_( height), width_( width) {
+Position::Position( int height, int width) {
 #ifdef _DEBUG
     if ( (height <= 0) || (width <= 0) ) {
         throw std::invalid_argument( (height <= 0) ? "height" : "width");
     }
 #endif
-    position_.assign( height * width, BLANK);
+    Assign( height, width, vector<int>( height * width, BLANK));
     return;
 }
 
-Position::Position( int height, int width, const vector<int>& position)
-    : height_( height), width_( width), position_( position) {
+Position::Position( int height, int width, const vector<int>& position) {
 #ifdef _DEBUG
     if ( (height <= 0) || (width <= 0) ) {
         throw std::invalid_argument( (height <= 0) ? "height" : "width");
@@ -34,6 +74,7 @@ Position::Position( int height, int width, const vector<int>& position)
         throw std::invalid_argument( "position");
     }
 #endif
+    Assign( height, width, position);
     return;
 }
 
@@ -43,13 +84,11 @@ Position::Position( const vector< vector<int> >& position) {
         throw std::invalid_argument( "position");
     }
 #endif
-    height_ = int( position.size());
-    width_ = int( position.front().size());
-    position_.clear();
+    vector<int> fields;
     for ( vector< vector<int> >::const_iterator line = position.begin();
           line != position.end(); ++line ) {
 #ifdef _DEBUG
-        if ( line->size() != width_ ) {
+        if ( line->size() != position.front().size() ) {
             throw std::invalid_argument( "position");
         }
 #endif
@@ -60,14 +99,81 @@ Position::Position( const vector< vector<int> >& position) {
                 throw std::invalid_argument( "position");
             }
 #endif
-            position_.push_back( *field);
+            fields.push_back( *field);
         } 
     }
+    Assign( int( position.size()), int( position.front().size()), fields);
+    return;
+}
+
+void Position::Assign( int height, int width, const vector<int>& position) {
+    height_ = height;
+    width_ = width;
+    std::memset( words_, 0, sizeof( words_));
+    wide_.clear();
+    hash_ = SplitMix( (uint64_t( height) << 32) | uint32_t( width));
+    for ( size_t index = 0; index < position.size(); ++index ) {
+        hash_ ^= ZobristKey( int( index), position[index]);
+    }
+    bool packed = (height * width <= INLINE_CELLS);
+    for ( size_t index = 0; packed && (index < position.size()); ++index ) {
+        packed = (position[index] <= MAX_PACKED_VALUE);
+    }
+    if ( !packed ) {
+        wide_ = position;
+    } else {
+        for ( size_t index = 0; index < position.size(); ++index ) {
+            Bytes()[index] = (unsigned char)( position[index] + 1);
+        }
+    }
+    TrackBlanks();
     return;
 }
 
-void Position::SetSize( int width, int height) {
-    Position( width, height);
+void Position::TrackBlanks() {
+    blank_count_ = 0;
+    for ( int index = 0; index < width_ * height_; ++index ) {
+        if ( Cell( index) != BLANK ) {
+            continue;
+        }
+        if ( (blank_count_ == MAX_TRACKED_BLANKS) || (index > 0xFFFF) ) {
+            blank_count_ = UNTRACKED;
+            return;
+        }
+        blanks_[blank_count_++] = uint16_t( index);
+    }
+    return;
+}
+
+void Position::Widen() {
+    vector<int> fields( width_ * height_);
+    for ( int index = 0; index < width_ * height_; ++index ) {
+        fields[index] = Cell( index);
+    }
+    std::memset( words_, 0, sizeof( words_));
+    wide_.swap( fields);
+    return;
+}
+
+void Position::SetCell( int index, int value) {
+    int old_value = Cell( index);
+    hash_ ^= ZobristKey( index, old_value) ^ ZobristKey( index, value);
+    if ( wide_.empty() && (value > MAX_PACKED_VALUE) ) {
+        Widen();
+    }
+    if ( wide_.empty() ) {
+        Bytes()[index] = (unsigned char)( value + 1);
+    } else {
+        wide_[index] = value;
+    }
+    if ( (old_value == BLANK) != (value == BLANK) ) {
+        TrackBlanks();
+    }
+    return;
+}
+
+void Position::SetSize( int height, int width) {
+    *this = Position( height, width);
     return;
 }
 
@@ -83,7 +189,7 @@ void Position::SetField( int v, int h, int value) {
         throw std::invalid_argument( "value");
     }
 #endif
-    position_[v * width_ + h] = value;
+    SetCell( v * width_ + h, value);
     return;
 }
 
@@ -96,7 +202,7 @@ void Position::SetField( int index, int value) {
         throw std::invalid_argument( "value");
     }
 #endif
-    position_[index] = value;
+    SetCell( index, value);
     return;
 }
 
@@ -109,7 +215,7 @@ int Position::GetField( int v, int h) const {
         throw std::invalid_argument( "h");
     }
 #endif
-    return position_[v * width_ + h];
+    return Cell( v * width_ + h);
 }
 
 int Position::GetField( int index) const {
@@ -118,17 +224,31 @@ int Position::GetField( int index) const {
         throw std::invalid_argument( "index");
     }
 #endif
-    return position_[index];
+    return Cell( index);
 }
 
 bool Position::operator==( const Position& operand) const {
-    return (width_ == operand.width_) && (height_ == operand.height_)
-        && (position_ == operand.position_);
+    if ( (width_ != operand.width_) || (height_ != operand.height_) ) {
+        return false;
+    }
+    if ( wide_.empty() && operand.wide_.empty() ) {
+        for ( int word = 0; word < UsedWords(); ++word ) {
+            if ( words_[word] != operand.words_[word] ) {
+                return false;
+            }
+        }
+        return true;
+    }
+    for ( int index = 0; index < width_ * height_; ++index ) {
+        if ( Cell( index) != operand.Cell( index) ) {
+            return false;
+        }
+    }
+    return true;
 }
 
 bool Position::operator!=( const Position& operand) const {
-    return (width_ != operand.width_) || (height_ != operand.height_)
-        || (position_ != operand.position_);
+    return !(*this == operand);
 }
 
 bool Position::operator<( const Position& operand) const {
@@ -137,10 +257,24 @@ bool Position::operator<( const Position& operand) const {
        throw std::logic_error( "Incomporable positions");
     }
 #endif
-    for ( size_t index = 0; index < position_.size(); ++index ) {
-       if ( position_[index] < operand.position_[index] ) {
+    if ( wide_.empty() && operand.wide_.empty() ) {
+        // Байты идут в порядке клеток, поэтому лексикографическое сравнение
+        // сводится к сравнению слов в порядке big-endian.
+        for ( int word = 0; word < UsedWords(); ++word ) {
+            if ( words_[word] != operand.words_[word] ) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+                return __builtin_bswap64( words_[word]) < __builtin_bswap64( operand.words_[word]);
+#else
+                return words_[word] < operand.words_[word];
+#endif
+            }
+        }
+        return false;
+    }
+    for ( int index = 0; index < width_ * height_; ++index ) {
+       if ( Cell( index) < operand.Cell( index) ) {
            return true;
-       } else if ( position_[index] > operand.position_[index] ) {
+       } else if ( Cell( index) > operand.Cell( index) ) {
            return false;
        }
     }
@@ -148,12 +282,14 @@ bool Position::operator<( const Position& operand) const {
 } 
 
 void Position::Shuffle( int move_count) {
+    NeighborTable table( *this);
+    MoveList moves;
     for ( int step = 0; step < move_count; ++step ) {
-        vector<Move> moves = GetPossibleMoves();
-        if ( !moves.size() ) {
+        GetPossibleMoves( table, moves);
+        if ( moves.Empty() ) {
             return;
         }
-        Move move = moves[rand() % moves.size()];
+        Move move = moves[rand() % moves.Size()];
         Swap( move.from, move.to);
     }
     return;
@@ -167,35 +303,67 @@ Position Position::GetShuffled( int move_count) const {
 
 vector<Position::Move> Position::GetPossibleMoves() const {
     vector<Move> result;
-    for ( int field = 0; field < int( position_.size()); ++field ) {
-        if ( position_[field] == BLANK ) {
+    GetPossibleMoves( result);
+    return result;
+}
+
+void Position::AddMoves( const NeighborTable& table, int blank, MoveList& result) const {
+    const int* neighbors = table.Neighbors( blank);
+    for ( int i = 0; i < table.Count( blank); ++i ) {
+        if ( Cell( neighbors[i]) != BLANK ) {
+            result.Push( Move( blank, neighbors[i]));
+        }
+    }
+    return;
+}
+
+void Position::GetPossibleMoves( const NeighborTable& table, MoveList& result) const {
+    result.Clear();
+    if ( blank_count_ != UNTRACKED ) {
+        for ( int i = 0; i < blank_count_; ++i ) {
+            AddMoves( table, blanks_[i], result);
+        }
+        return;
+    }
+    for ( int field = 0; field < width_ * height_; ++field ) {
+        if ( Cell( field) == BLANK ) {
+            AddMoves( table, field, result);
+        }
+    }
+    return;
+}
+
+void Position::GetPossibleMoves( vector<Move>& result) const {
+    result.clear();
+    for ( int field = 0; field < width_ * height_; ++field ) {
+        if ( Cell( field) == BLANK ) {
             if ( field >= width_ ) {
                 int to = field - width_;
-                if ( (position_[to] != BLANK) && (position_[to] != STONE) ) {
+                if ( (Cell( to) != BLANK) && (Cell( to) != STONE) ) {
                     result.push_back( Move( field, to));
                 }
             }
             if ( (field + 1) % width_ ) {
                 int to = field + 1;
-                if ( (position_[to] != BLANK) && (position_[to] != STONE) ) {
+                if ( (Cell( to) != BLANK) && (Cell( to) != STONE) ) {
                     result.push_back( Move( field, to));
                 }
             }
             if ( field + width_ < width_ * height_ ) {
                 int to = field + width_;
-                if ( (position_[to] != BLANK) && (position_[to] != STONE) ) {
+                if ( (Cell( to) != BLANK) && (Cell( to) != STONE) ) {
                     result.push_back( Move( field, to));
                 } 
             }
             if ( field % width_ ) {
                 int to = field - 1;
-                if ( (position_[to] != BLANK) && (position_[to] != STONE) ) {
+                if ( (Cell( to) != BLANK) && (Cell( to) != STONE) ) {
                     result.push_back( Move( field, to));
                 }
             }
         }
     }
-    return result;
+    return;
 }
 
 
@@ -214,7 +382,7 @@ void Position::Swap( int vfrom, int hfrom, int vto, int hto) {
         throw std::invalid_argument( "hto");
     }
 #endif
-    std::swap( position_[vfrom * width_ + hfrom], position_[vto * width_ + hto]);
+    Swap( vfrom * width_ + hfrom, vto * width_ + hto);
     return;
 }
 
@@ -227,7 +395,23 @@ void Position::Swap( int from, int to) {
         throw std::invalid_argument( "to");
     }
 #endif
-    std::swap( position_[from], position_[to]);
+    int from_value = Cell( from), to_value = Cell( to);
+    hash_ ^= ZobristKey( from, from_value) ^ ZobristKey( to, to_value)
+        ^ ZobristKey( from, to_value) ^ ZobristKey( to, from_value);
+    if ( (blank_count_ > 0) && ((from_value == BLANK) != (to_value == BLANK)) ) {
+        int blank = (from_value == BLANK) ? from : to;
+        for ( int i = 0; i < blank_count_; ++i ) {
+            if ( blanks_[i] == blank ) {
+                blanks_[i] = uint16_t( from + to - blank);
+                break;
+            }
+        }
+    }
+    if ( wide_.empty() ) {
+        std::swap( Bytes()[from], Bytes()[to]);
+    } else {
+        std::swap( wide_[from], wide_[to]);
+    }
     return;
 }
     
@@ -244,16 +428,16 @@ Position Position::GetSwaped( int from, int to) const {
 }
     
 std::ostream& operator<<(std::ostream &stream, const Position& t) {
-    for ( size_t i = 0; i < t.position_.size(); ++i ) {
-        if ( t.position_[i] == Position::STONE ) {
-            std::cout << "X ";
-        } else if ( t.position_[i] == Position::BLANK ) {
-            std::cout << ". ";
+    for ( int i = 0; i < t.width_ * t.height_; ++i ) {
+        if ( t.Cell( i) == Position::STONE ) {
+            stream << "X ";
+        } else if ( t.Cell( i) == Position::BLANK ) {
+            stream << ". ";
         } else {
-            std::cout << t.position_[i] << ' ';
+            stream << t.Cell( i) << ' ';
         }
         if ( !((i + 1) % t.width_) ) {
-            std::cout << std::endl;
+            stream << std::endl;
         } 
     }
     return stream;
@@ -274,6 +458,28 @@ bool Position::Move::operator==( const Move& operand) const {
            || ((from == operand.to) && (to == operand.from));
 }
 
+NeighborTable::NeighborTable() {
+}
+
+NeighborTable::NeighborTable( const Position& position) {
+    int width = position.Width(), cells = position.Height() * position.Width();
+    neighbors_.assign( cells * 4, -1);
+    counts_.assign( cells, 0);
+    for ( int cell = 0; cell < cells; ++cell ) {
+        if ( position.GetField( cell) == Position::STONE ) {
+            continue;
+        }
+        int candidates[4] = {cell - width, ((cell + 1) % width) ? cell + 1 : -1,
+                             cell + width, (cell % width) ? cell - 1 : -1};
+        for ( int i = 0; i < 4; ++i ) {
+            if ( (candidates[i] >= 0) && (candidates[i] < cells)
+                 && (position.GetField( candidates[i]) != Position::STONE) ) {
+                neighbors_[cell * 4 + counts_[cell]++] = candidates[i];
+            }
+        }
+    }
+}
+
 bool Position::IsSimular( const Position& to) const {
     if ( (width_ != to.width_) || (height_ != to.height_) ) {
         return false;
@@ -281,11 +487,11 @@ bool Position::IsSimular( const Position& to) const {
     std::map<int, int> counter;
     for ( int v = 0; v < height_; ++v ) {
         for ( int h = 0; h < width_; ++h ) {
-            if ( (position_[v * width_ + h] == STONE) && (to.position_[v * width_ + h] != STONE) ) {
+            if ( (Cell( v * width_ + h) == STONE) && (to.Cell( v * width_ + h) != STONE) ) {
                 return false;
             }
-            counter[position_[v * width_ + h]]++;
-            counter[to.position_[v * width_ + h]]--;
+            counter[Cell( v * width_ + h)]++;
+            counter[to.Cell( v * width_ + h)]--;
         }
     }
     for ( std::map<int, int>::iterator it = counter.begin();
@@ -301,13 +507,13 @@ int Position::Distance( const Position& to) const {
     std::map< int, vector<int> > invert_positions;
     int result = 0;
     for ( int i = 0; i < width_ * height_; ++i ) {
-        int value = to.position_[i];
+        int value = to.Cell( i);
         if ( (value != BLANK) && (value != STONE) ) {
             invert_positions[value].push_back( i);
         }
     }
     for ( int from = 0; from < width_ * height_; ++from ) {
-        int value = position_[from];
+        int value = Cell( from);
         if ( (value == BLANK) || (value == STONE) ) {
             continue;
         }
@@ -323,18 +529,18 @@ int Position::Distance( const Position& to) const {
 
 int Position::UpdateDistance( const Position& to, int old_distance, int move_from, int move_to) const {
     int value, old_from, new_from;
-    if ( position_[move_to] != BLANK ) {
-        value = position_[move_to];
+    if ( Cell( move_to) != BLANK ) {
+        value = Cell( move_to);
         old_from = move_from;
         new_from = move_to;
     } else {
-        value = position_[move_from];
+        value = Cell( move_from);
         old_from = move_to;
         new_from = move_from;
     }
     int old_part = std::numeric_limits<int>::max(), new_part = std::numeric_limits<int>::max();
     for ( int i = 0; i < width_ * height_; ++i ) {
-        if ( to.position_[i] == value ) {
+        if ( to.Cell( i) == value ) {
             old_part = std::min( old_part, abs( old_from % width_ - i % width_) + abs( old_from / width_ - i / width_));
             new_part = std::min( new_part, abs( new_from % width_ - i % width_) + abs( new_from / width_ - i / width_));
         }
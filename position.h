@@ -4,15 +4,25 @@
 
 #include <vector>
 #include <iostream>
+#include <stdint.h>
 
 using std::vector;
 
+class NeighborTable;
+
 // Класс для хранения и обработки состояния игрового поля.
 // Элементами поля могут быть положительные целые числа (не обязательно различные),
 // камни (Position::STONE) и пустые места( Position::BLANK).
+// Поля до INLINE_CELLS клеток со значениями не больше MAX_PACKED_VALUE хранятся
+// упакованными по байту на клетку прямо в объекте (копирование без выделения памяти,
+// сравнение по машинным словам), остальные - в vector<int>.
+// Хеш Зобриста поддерживается инкрементально при каждом изменении клетки.
+// Клетки пустых мест (если их не больше MAX_TRACKED_BLANKS) отслеживаются,
+// чтобы генерация ходов не просматривала все поле.
 class Position {
 public:
     struct Move;
+    class MoveList;
     Position();
     Position( int height, int width);
     Position( int height, int width, const vector<int>& position);
@@ -25,10 +35,18 @@ public:
     bool operator==( const Position& operand) const;
     bool operator!=( const Position& operand) const;
     bool operator<( const Position& operand) const;
+    uint64_t Hash() const {return hash_;}
+    // true, если поле хранится в упакованном виде.
+    bool IsPacked() const {return wide_.empty();}
 	// Делает move_count случайных допустимых ходов.
     void Shuffle( int move_count);
     Position GetShuffled( int step_count) const;
     vector<Move> GetPossibleMoves() const;
+    // То же, но заполняет переданный вектор, не выделяя памяти при достаточной емкости.
+    void GetPossibleMoves( vector<Move>& result) const;
+    // Ходы без выделения памяти; table должна быть построена по позиции
+    // с теми же размерами и камнями.
+    void GetPossibleMoves( const NeighborTable& table, MoveList& result) const;
     void Swap( int vfrom, int hfrom, int vto, int hto);
     void Swap( int from, int to);
     Position GetSwaped( int vfrom, int gfrom, int vto, int gto) const;
@@ -46,12 +64,33 @@ public:
     friend std::ostream& operator<<(std::ostream &stream, const Position& t);
     const static int BLANK;
     const static int STONE;
+    const static int MAX_PACKED_VALUE;
 
-    
 private:
-    vector<int> position_;
+    enum { INLINE_CELLS = 32, INLINE_WORDS = INLINE_CELLS / 8 };
+    enum { MAX_TRACKED_BLANKS = 4, UNTRACKED = -1 };
+    int Cell( int index) const {
+        return wide_.empty() ? int( Bytes()[index]) - 1 : wide_[index];
+    }
+    void SetCell( int index, int value);
+    const unsigned char* Bytes() const {return reinterpret_cast<const unsigned char*>( words_);}
+    unsigned char* Bytes() {return reinterpret_cast<unsigned char*>( words_);}
+    int UsedWords() const {return (width_ * height_ + 7) / 8;}
+    void Assign( int height, int width, const vector<int>& position);
+    void Widen();
+    void TrackBlanks();
+    void AddMoves( const NeighborTable& table, int blank, MoveList& result) const;
+    static uint64_t ZobristKey( int index, int value);
     int height_;
     int width_;
+    uint64_t hash_;
+    // Упакованное поле: значение клетки хранится как value + 1, хвост заполнен нулями.
+    uint64_t words_[INLINE_WORDS];
+    // Поле в общем виде; пусто, если используется упакованное.
+    vector<int> wide_;
+    // Клетки пустых мест; blank_count_ == UNTRACKED, если их слишком много.
+    uint16_t blanks_[MAX_TRACKED_BLANKS];
+    int blank_count_;
 };
 
 struct Position::Move {
@@ -62,6 +101,49 @@ struct Position::Move {
     bool operator==( const Move& operand) const;
 };
 
+// Список ходов фиксированной емкости; не выделяет память, пока ходов не
+// больше CAPACITY.
+class Position::MoveList {
+public:
+    MoveList() : size_( 0) {}
+    void Clear() {
+        size_ = 0;
+        overflow_.clear();
+    }
+    void Push( const Move& move) {
+        if ( size_ < CAPACITY ) {
+            moves_[size_] = move;
+        } else {
+            overflow_.push_back( move);
+        }
+        ++size_;
+    }
+    int Size() const {return size_;}
+    bool Empty() const {return !size_;}
+    const Move& operator[]( int index) const {
+        return (index < CAPACITY) ? moves_[index] : overflow_[index - CAPACITY];
+    }
+    enum { CAPACITY = 16 };
+private:
+    Move moves_[CAPACITY];
+    int size_;
+    vector<Move> overflow_;
+};
+
+// Соседи каждой клетки поля (вверх, вправо, вниз, влево) без выхода за края и
+// без камней. Камни неподвижны, поэтому таблица, построенная по позиции,
+// подходит для всех позиций, достижимых из нее.
+class NeighborTable {
+public:
+    NeighborTable();
+    explicit NeighborTable( const Position& position);
+    int Count( int cell) const {return counts_[cell];}
+    const int* Neighbors( int cell) const {return &neighbors_[cell * 4];}
+private:
+    vector<int> neighbors_;
+    vector<int> counts_;
+};
+
 std::ostream& operator<<(std::ostream& stream, const Position& t);
 
 #endif /* _POSITION_H_ */
@@ -0,0 +1,160 @@
+#include "reachability.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Значения клеток cells позиции по порядку.
+std::vector<int> Values( const Position& position, const std::vector<int>& cells) {
+    std::vector<int> values;
+    values.reserve( cells.size());
+    for ( size_t index = 0; index < cells.size(); ++index ) {
+        values.push_back( position.GetField( cells[index]));
+    }
+    return values;
+}
+
+// Фишки вдоль коридора без пустых мест.
+std::vector<int> Tiles( const Position& position, const std::vector<int>& cells) {
+    std::vector<int> tiles;
+    for ( size_t index = 0; index < cells.size(); ++index ) {
+        int value = position.GetField( cells[index]);
+        if ( value != Position::BLANK ) {
+            tiles.push_back( value);
+        }
+    }
+    return tiles;
+}
+
+// Клетки области, у которой все клетки имеют не больше двух соседей, в
+// порядке обхода; cycle - замкнута ли область. false, если область не коридор.
+bool Corridor( const NeighborTable& table, const std::vector<int>& cells, std::vector<int>& order, bool& cycle) {
+    int start = cells.front();
+    for ( size_t index = 0; index < cells.size(); ++index ) {
+        if ( table.Count( cells[index]) > 2 ) {
+            return false;
+        }
+        if ( table.Count( cells[index]) < table.Count( start) ) {
+            start = cells[index];
+        }
+    }
+    cycle = (table.Count( start) == 2);
+    order.clear();
+    for ( int previous = -1, cell = start; order.size() < cells.size(); ) {
+        order.push_back( cell);
+        const int* neighbors = table.Neighbors( cell);
+        int next = (neighbors[0] != previous) ? neighbors[0] : neighbors[1];
+        previous = cell;
+        cell = next;
+    }
+    return true;
+}
+
+// Четность перестановки клеток, переводящей source в goal; фишки различны.
+bool OddPermutation( const Position& source, const Position& goal, const std::vector<int>& cells) {
+    std::vector< std::pair<int, int> > from, to;
+    for ( size_t index = 0; index < cells.size(); ++index ) {
+        from.push_back( std::make_pair( source.GetField( cells[index]), int( index)));
+        to.push_back( std::make_pair( goal.GetField( cells[index]), int( index)));
+    }
+    std::sort( from.begin(), from.end());
+    std::sort( to.begin(), to.end());
+    std::vector<int> permutation( cells.size());
+    for ( size_t index = 0; index < from.size(); ++index ) {
+        permutation[from[index].second] = to[index].second;
+    }
+    bool odd = false;
+    std::vector<bool> visited( cells.size(), false);
+    for ( size_t index = 0; index < cells.size(); ++index ) {
+        // Цикл длины n - это n - 1 транспозиций.
+        for ( int cell = int( index); !visited[cell]; cell = permutation[cell] ) {
+            visited[cell] = true;
+            if ( cell != int( index) ) {
+                odd = !odd;
+            }
+        }
+    }
+    return odd;
+}
+
+} // namespace
+
+bool CheckReachability( const Position& source, const Position& goal, std::string& error_msg) {
+    if ( !goal.IsSimular( source) ) {
+        error_msg = "Positions not simular";
+        return false;
+    }
+    NeighborTable table( source);
+    int width = source.Width();
+    int count = source.Height() * width;
+    std::vector<int> region( count, -1);
+    std::vector<int> cells, order;
+    for ( int first = 0; first < count; ++first ) {
+        if ( (region[first] != -1) || (source.GetField( first) == Position::STONE) ) {
+            continue;
+        }
+        // Клетки области в порядке обхода в ширину.
+        cells.assign( 1, first);
+        region[first] = first;
+        for ( size_t index = 0; index < cells.size(); ++index ) {
+            const int* neighbors = table.Neighbors( cells[index]);
+            for ( int neighbor = 0; neighbor < table.Count( cells[index]); ++neighbor ) {
+                if ( region[neighbors[neighbor]] == -1 ) {
+                    region[neighbors[neighbor]] = first;
+                    cells.push_back( neighbors[neighbor]);
+                }
+            }
+        }
+        std::vector<int> source_values = Values( source, cells);
+        std::vector<int> goal_values = Values( goal, cells);
+        if ( std::count( source_values.begin(), source_values.end(), int( Position::BLANK)) == 0 ) {
+            if ( source_values != goal_values ) {
+                error_msg = "No solution (isolated regions)";
+                return false;
+            }
+            continue;
+        }
+        std::sort( source_values.begin(), source_values.end());
+        std::sort( goal_values.begin(), goal_values.end());
+        if ( source_values != goal_values ) {
+            error_msg = "No solution (isolated regions)";
+            return false;
+        }
+        bool cycle;
+        if ( Corridor( table, cells, order, cycle) ) {
+            std::vector<int> source_tiles = Tiles( source, order);
+            std::vector<int> goal_tiles = Tiles( goal, order);
+            bool same = (source_tiles == goal_tiles);
+            if ( cycle && !same ) {
+                // На кольце фишки могут только сдвинуться по кругу.
+                source_tiles.insert( source_tiles.end(), source_tiles.begin(), source_tiles.end());
+                same = (std::search( source_tiles.begin(), source_tiles.end(), goal_tiles.begin(), goal_tiles.end()) != source_tiles.end());
+            }
+            if ( !same ) {
+                error_msg = "No solution (corridor order)";
+                return false;
+            }
+        }
+        // Четность ограничивает только при одном пустом месте и различных фишках.
+        if ( std::adjacent_find( source_values.begin(), source_values.end()) != source_values.end() ) {
+            continue;
+        }
+        int source_blank = -1, goal_blank = -1;
+        for ( size_t index = 0; index < cells.size(); ++index ) {
+            if ( source.GetField( cells[index]) == Position::BLANK ) {
+                source_blank = cells[index];
+            }
+            if ( goal.GetField( cells[index]) == Position::BLANK ) {
+                goal_blank = cells[index];
+            }
+        }
+        // Ход - транспозиция и смена цвета клетки пустого места в шахматной раскраске.
+        bool odd_moves = ((source_blank / width + source_blank % width + goal_blank / width + goal_blank % width) % 2) != 0;
+        if ( OddPermutation( source, goal, cells) != odd_moves ) {
+            error_msg = "No solution (parity)";
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+#ifndef _REACHABILITY_H_
+#define _REACHABILITY_H_
+
+#include <string>
+#include "position.h"
+
+// Проверка перед поиском, что goal может быть достижима из source. Камни
+// делят поле на связные области, между которыми фишки не переходят, поэтому
+// в каждой области должны совпадать количества пустых мест и наборы фишек, а
+// область без пустых мест должна совпадать с целью. В области, где клетки
+// образуют коридор или кольцо, фишки не обгоняют друг друга. В области с
+// одним пустым местом и различными фишками четность перестановки совпадает с
+// четностью расстояния, пройденного пустым местом (поле двудольно). Повторы
+// фишек и несколько пустых мест снимают это ограничение: обмен одинаковых
+// фишек меняет четность.
+// false и error_msg, если цель недостижима; true не гарантирует решения, но
+// для прямоугольного поля без камней с одним пустым местом и различными
+// фишками проверка точна. Время линейно от размера поля (с сортировкой фишек
+// в областях).
+bool CheckReachability( const Position& source, const Position& goal, std::string& error_msg);
+
+#endif /* _REACHABILITY_H_ */
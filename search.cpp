@@ -1,125 +1,577 @@
 #include "search.h"
+#include "reachability.h"
 #include <utility>
 #include <stdexcept>
 #include <algorithm>
+#include <new>
+#include <thread>
 
-Vertex::Vertex( const Position& position_, int cost_, int h_, int heuristic_, const VertexPtr& parent_)
-    : position( position_), cost( cost_), h( h_), heuristic( heuristic_), parent( parent_) {
+Vertex::Vertex( const Position& position_, int cost_, int h_, int heuristic_, NodeIndex parent_)
+    : position( position_), cost( cost_), h( h_), heuristic( heuristic_), parent( parent_),
+      open_prev( NO_NODE), open_next( NO_NODE), opened( false) {
 }
 
-Vertex::Vertex() {
+Vertex::Vertex()
+    : open_prev( NO_NODE), open_next( NO_NODE), opened( false) {
 }
 
-bool PoolCompare::operator()( const VertexPtr& operand1, const VertexPtr& operand2) const {
-    return operand1->position < operand2->position;
+VertexArena::VertexArena()
+    : size_( 0), wide_count_( 0) {
 }
 
-VertexPtr VertexPool::Find( const Position& position) {
-    VertexPtr to_find( new Vertex( position, 0, 0, 0, VertexPtr()));
-    Pool::iterator place = pool_.find( to_find);
-    if ( place == pool_.end() ) {
-        return VertexPtr();
-    } else {
-        return *place;
-    }
+VertexArena::~VertexArena() {
+    Release();
 }
 
-void VertexPool::Insert( const VertexPtr& vertex) {
+NodeIndex VertexArena::Allocate( const Position& position, int cost, int h, int heuristic, NodeIndex parent) {
+    if ( size_ == chunks_.size() * CHUNK_SIZE ) {
 #ifdef _DEBUG
-    std::pair<Pool::iterator, bool> result = 
+        if ( size_ >= size_t( NO_NODE) - CHUNK_SIZE ) {
+            throw std::length_error( "Too many vertices");
+        }
 #endif
-	pool_.insert( vertex);
+        chunks_.push_back( static_cast<Vertex*>( ::operator new( CHUNK_SIZE * sizeof( Vertex))));
+    }
+    NodeIndex index = NodeIndex( size_);
+    new ( &(*this)[index]) Vertex( position, cost, h, heuristic, parent);
+    if ( !position.IsPacked() ) {
+        ++wide_count_;
+    }
+    ++size_;
+    return index;
+}
+
+size_t VertexArena::CapacityAfter( size_t count) const {
+    size_t chunks = (size_ + count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    return std::max( chunks, chunks_.size()) * CHUNK_SIZE * sizeof( Vertex);
+}
+
+void VertexArena::Clear() {
+    // Упакованные позиции не владеют памятью, поэтому деструкторы вершин
+    // вызываются, только если среди них есть позиции в общем виде.
+    if ( wide_count_ ) {
+        for ( size_t index = 0; index < size_; ++index ) {
+            (*this)[NodeIndex( index)].~Vertex();
+        }
+    }
+    size_ = 0;
+    wide_count_ = 0;
+    return;
+}
+
+void VertexArena::Release() {
+    Clear();
+    for ( std::vector<Vertex*>::iterator chunk = chunks_.begin(); chunk != chunks_.end(); ++chunk ) {
+        ::operator delete( *chunk);
+    }
+    std::vector<Vertex*>().swap( chunks_);
+    return;
+}
+
+const double VertexPool::MAX_LOAD_FACTOR = 0.5;
+
+VertexPool::VertexPool( const VertexArena& arena)
+    : arena_( arena), size_( 0) {
+}
+
+NodeIndex VertexPool::Find( const Position& position) const {
+    if ( slots_.empty() ) {
+        return NO_NODE;
+    }
+    uint64_t hash = position.Hash();
+    size_t mask = slots_.size() - 1;
+    for ( size_t index = size_t( hash) & mask; slots_[index].vertex != NO_NODE; index = (index + 1) & mask ) {
+        if ( (slots_[index].hash == hash) && (arena_[slots_[index].vertex].position == position) ) {
+            return slots_[index].vertex;
+        }
+    }
+    return NO_NODE;
+}
+
+void VertexPool::Insert( NodeIndex vertex) {
 #ifdef _DEBUG
-    if ( !result.second ) {
+    if ( Find( arena_[vertex].position) != NO_NODE ) {
         throw std::logic_error( "Vertex already in pool");
     }
 #endif
+    if ( double( size_ + 1) > MAX_LOAD_FACTOR * double( slots_.size()) ) {
+        Rehash( std::max( slots_.size() * 2, size_t( 1024)));
+    }
+    uint64_t hash = arena_[vertex].position.Hash();
+    size_t mask = slots_.size() - 1;
+    size_t index = size_t( hash) & mask;
+    while ( slots_[index].vertex != NO_NODE ) {
+        index = (index + 1) & mask;
+    }
+    slots_[index].hash = hash;
+    slots_[index].vertex = vertex;
+    ++size_;
     return;
 }
 
-bool OpenedSetCompare::operator()( const VertexPtr& operand1, const VertexPtr& operand2) const {
-    return (operand1->heuristic < operand2->heuristic)
-           || ((operand1->heuristic == operand2->heuristic) && (operand1->cost > operand2->cost))
-           || ((operand1->heuristic == operand2->heuristic) && (operand1->cost == operand2->cost) && (operand1->position < operand2->position)); 
+void VertexPool::Reserve( size_t count) {
+    size_t capacity = 1024;
+    while ( double( count) > MAX_LOAD_FACTOR * double( capacity) ) {
+        capacity *= 2;
+    }
+    if ( capacity > slots_.size() ) {
+        Rehash( capacity);
+    }
+    return;
 }
 
-bool OpenedSet::FindAndErase( const VertexPtr& vertex) {
-    Set::iterator place = set_.find( vertex);
-    if ( place == set_.end() ) {
-        return false;
+void VertexPool::Clear() {
+    std::fill( slots_.begin(), slots_.end(), Slot());
+    size_ = 0;
+    return;
+}
+
+void VertexPool::Release() {
+    std::vector<Slot>().swap( slots_);
+    size_ = 0;
+    return;
+}
+
+size_t VertexPool::PeakCapacity( size_t count) const {
+    size_t slots = slots_.size();
+    size_t peak = slots;
+    while ( double( size_ + count) > MAX_LOAD_FACTOR * double( slots) ) {
+        size_t next = std::max( slots * 2, size_t( 1024));
+        peak = std::max( peak, slots + next);
+        slots = next;
+    }
+    return peak * sizeof( Slot);
+}
+
+double VertexPool::LoadFactor() const {
+    return slots_.empty() ? 0.0 : double( size_) / double( slots_.size());
+}
+
+void VertexPool::Rehash( size_t capacity) {
+    std::vector<Slot> old_slots( capacity);
+    old_slots.swap( slots_);
+    size_t mask = capacity - 1;
+    for ( std::vector<Slot>::iterator slot = old_slots.begin(); slot != old_slots.end(); ++slot ) {
+        if ( slot->vertex == NO_NODE ) {
+            continue;
+        }
+        size_t index = size_t( slot->hash) & mask;
+        while ( slots_[index].vertex != NO_NODE ) {
+            index = (index + 1) & mask;
+        }
+        slots_[index] = *slot;
+    }
+    return;
+}
+
+OpenedSet::OpenedSet( VertexArena& arena)
+    : arena_( arena), min_heuristic_( 0), size_( 0), capacity_( 0) {
+}
+
+void OpenedSet::Link( NodeIndex index) {
+    Vertex& vertex = arena_[index];
+    size_t heuristic = size_t( vertex.heuristic);
+    size_t cost = size_t( vertex.cost);
+    if ( heuristic >= buckets_.size() ) {
+        capacity_ += (heuristic + 1 - buckets_.size()) * (sizeof( std::vector<NodeIndex>) + sizeof( size_t) + sizeof( int));
+        buckets_.resize( heuristic + 1);
+        occupancy_.resize( heuristic + 1, 0);
+        max_cost_.resize( heuristic + 1, 0);
+    }
+    std::vector<NodeIndex>& line = buckets_[heuristic];
+    if ( cost >= line.size() ) {
+        capacity_ += (cost + 1 - line.size()) * sizeof( NodeIndex);
+        line.resize( cost + 1, NO_NODE);
+    }
+    vertex.open_prev = NO_NODE;
+    vertex.open_next = line[cost];
+    if ( line[cost] != NO_NODE ) {
+        arena_[line[cost]].open_prev = index;
+    }
+    line[cost] = index;
+    vertex.opened = true;
+    ++occupancy_[heuristic];
+    max_cost_[heuristic] = std::max( max_cost_[heuristic], int( cost));
+    min_heuristic_ = std::min( min_heuristic_, heuristic);
+    ++size_;
+    return;
+}
+
+void OpenedSet::Unlink( NodeIndex index) {
+    Vertex& vertex = arena_[index];
+    if ( vertex.open_prev != NO_NODE ) {
+        arena_[vertex.open_prev].open_next = vertex.open_next;
+    } else {
+        buckets_[vertex.heuristic][vertex.cost] = vertex.open_next;
+    }
+    if ( vertex.open_next != NO_NODE ) {
+        arena_[vertex.open_next].open_prev = vertex.open_prev;
     }
-    set_.erase( place);
-    return true;
+    vertex.open_prev = vertex.open_next = NO_NODE;
+    vertex.opened = false;
+    --occupancy_[vertex.heuristic];
+    --size_;
+    return;
 }
 
-void OpenedSet::Insert( const VertexPtr& vertex) {
+void OpenedSet::Insert( NodeIndex vertex) {
 #ifdef _DEBUG
-    std::pair<Set::iterator, bool> result = 
+    if ( arena_[vertex].opened ) {
+        throw std::logic_error( "Vertex already opened");
+    }
 #endif
-	set_.insert( vertex);
+    Link( vertex);
+    return;
+}
+
+void OpenedSet::DecreaseKey( NodeIndex index, int cost) {
 #ifdef _DEBUG
-    if ( !result.second ) {
-        throw std::logic_error( "Vertex already opened");
+    if ( !arena_[index].opened ) {
+        throw std::logic_error( "Vertex not opened");
     }
 #endif
+    Unlink( index);
+    Vertex& vertex = arena_[index];
+    vertex.heuristic += cost - vertex.cost;
+    vertex.cost = cost;
+    Link( index);
     return;
 }
 
-VertexPtr OpenedSet::ExtractMin() {
-    VertexPtr result;
+void OpenedSet::Remove( NodeIndex vertex) {
 #ifdef _DEBUG
-    if ( set_.empty() ) {
+    if ( !arena_[vertex].opened ) {
+        throw std::logic_error( "Vertex not opened");
+    }
+#endif
+    Unlink( vertex);
+    return;
+}
+
+int OpenedSet::MinHeuristic() {
+#ifdef _DEBUG
+    if ( !size_ ) {
+        throw std::logic_error( "Opened set is empty");
+    }
+#endif
+    while ( !occupancy_[min_heuristic_] ) {
+        ++min_heuristic_;
+    }
+    return int( min_heuristic_);
+}
+
+NodeIndex OpenedSet::ExtractMin() {
+#ifdef _DEBUG
+    if ( !size_ ) {
         throw std::logic_error( "Nothing to extract");
     }
 #endif
-    Set::iterator min = set_.begin();
-    result = *min;
-    set_.erase( min);
+    MinHeuristic();
+    std::vector<NodeIndex>& line = buckets_[min_heuristic_];
+    int cost = max_cost_[min_heuristic_];
+    while ( line[cost] == NO_NODE ) {
+        --cost;
+    }
+    max_cost_[min_heuristic_] = cost;
+    NodeIndex result = line[cost];
+    Unlink( result);
     return result;
 }
 
-bool OpenedSet::Empty() {
-    return set_.empty();
+void OpenedSet::Clear() {
+    for ( size_t heuristic = 0; heuristic < buckets_.size(); ++heuristic ) {
+        std::fill( buckets_[heuristic].begin(), buckets_[heuristic].end(), NO_NODE);
+    }
+    std::fill( occupancy_.begin(), occupancy_.end(), 0);
+    std::fill( max_cost_.begin(), max_cost_.end(), 0);
+    min_heuristic_ = 0;
+    size_ = 0;
+    return;
+}
+
+void OpenedSet::Release() {
+    std::vector< std::vector<NodeIndex> >().swap( buckets_);
+    std::vector<size_t>().swap( occupancy_);
+    std::vector<int>().swap( max_cost_);
+    min_heuristic_ = 0;
+    size_ = 0;
+    capacity_ = 0;
+    return;
+}
+
+void SharedHashSet::Grow( Shard& shard) {
+    std::vector<uint64_t> old_tags( std::max( shard.tags.size() * 2, size_t( 1024)), 0);
+    old_tags.swap( shard.tags);
+    size_t mask = shard.tags.size() - 1;
+    for ( size_t old = 0; old < old_tags.size(); ++old ) {
+        if ( !old_tags[old] ) {
+            continue;
+        }
+        size_t index = size_t( old_tags[old]) & mask;
+        while ( shard.tags[index] ) {
+            index = (index + 1) & mask;
+        }
+        shard.tags[index] = old_tags[old];
+    }
+    return;
+}
+
+void SharedHashSet::Insert( uint64_t hash) {
+    uint64_t tag = Tag( hash);
+    Shard& shard = shards_[ShardIndex( hash)];
+    std::lock_guard<std::mutex> lock( shard.mutex);
+    if ( double( shard.size + 1) > VertexPool::MAX_LOAD_FACTOR * double( shard.tags.size()) ) {
+        Grow( shard);
+    }
+    size_t mask = shard.tags.size() - 1;
+    size_t index = size_t( tag) & mask;
+    while ( shard.tags[index] ) {
+        if ( shard.tags[index] == tag ) {
+            return;
+        }
+        index = (index + 1) & mask;
+    }
+    shard.tags[index] = tag;
+    ++shard.size;
+    return;
+}
+
+bool SharedHashSet::MayContain( uint64_t hash) const {
+    uint64_t tag = Tag( hash);
+    const Shard& shard = shards_[ShardIndex( hash)];
+    std::lock_guard<std::mutex> lock( shard.mutex);
+    if ( shard.tags.empty() ) {
+        return false;
+    }
+    size_t mask = shard.tags.size() - 1;
+    for ( size_t index = size_t( tag) & mask; shard.tags[index]; index = (index + 1) & mask ) {
+        if ( shard.tags[index] == tag ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SharedHashSet::Clear() {
+    for ( int shard = 0; shard < SHARD_COUNT; ++shard ) {
+        std::fill( shards_[shard].tags.begin(), shards_[shard].tags.end(), 0);
+        shards_[shard].size = 0;
+    }
+    return;
+}
+
+void SharedHashSet::Release() {
+    for ( int shard = 0; shard < SHARD_COUNT; ++shard ) {
+        std::vector<uint64_t>().swap( shards_[shard].tags);
+        shards_[shard].size = 0;
+    }
+    return;
+}
+
+NodeIndex BestOpened( const VertexArena& arena) {
+    NodeIndex best = NO_NODE;
+    for ( NodeIndex vertex = 0; vertex < NodeIndex( arena.Size()); ++vertex ) {
+        const Vertex& current = arena[vertex];
+        if ( current.opened
+             && ((best == NO_NODE) || (current.h < arena[best].h) || ((current.h == arena[best].h) && (current.cost < arena[best].cost))) ) {
+            best = vertex;
+        }
+    }
+    return best;
 }
 
 const int AStarSearcher::ITERATION_COUNT = 10000;
 
-std::pair<bool, VertexPtr> AStarSearcher::SideSearch( OpenedSet& opened_set, VertexPool& pool, Position& goal, VertexPool& check) {
+AStarSearcher::AStarSearcher()
+    : reuse_arena_( false), concurrent_( false), heuristic_( 0), time_limit_( 0), control_( 0), interrupted_( NOT_STOPPED),
+      pool_source_( arena_source_), pool_goal_( arena_goal_),
+      opened_set_source_( arena_source_), opened_set_goal_( arena_goal_), stop_( RUNNING), shared_nodes_( 0) {
+}
+
+void AStarSearcher::Reset() {
+    opened_set_source_.Clear();
+    opened_set_goal_.Clear();
+    pool_source_.Clear();
+    pool_goal_.Clear();
+    arena_source_.Clear();
+    arena_goal_.Clear();
+    shared_source_.Clear();
+    shared_goal_.Clear();
+    return;
+}
+
+void AStarSearcher::Release() {
+    opened_set_source_.Release();
+    opened_set_goal_.Release();
+    pool_source_.Release();
+    pool_goal_.Release();
+    arena_source_.Release();
+    arena_goal_.Release();
+    shared_source_.Release();
+    shared_goal_.Release();
+    return;
+}
+
+void AStarSearcher::Report() {
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    progress_( stats_);
+    return;
+}
+
+bool AStarSearcher::StopSearch( Stop reason) {
+    int running = RUNNING;
+    return stop_.compare_exchange_strong( running, reason);
+}
+
+void AStarSearcher::Interrupt( StopReason reason) {
+    // Причину записывает только остановивший поиск поток; читается после join.
+    if ( StopSearch( INTERRUPTED) ) {
+        interrupted_ = reason;
+    }
+    return;
+}
+
+size_t AStarSearcher::MemoryUsage() const {
+    return arena_source_.Capacity() + arena_goal_.Capacity() + pool_source_.Capacity() + pool_goal_.Capacity();
+}
+
+NodeIndex AStarSearcher::ConcurrentSideSearch( VertexArena& arena, OpenedSet& opened_set, VertexPool& pool, SharedHashSet& own,
+                                               const SharedHashSet& other, const Heuristic& heuristic, SearchStats::Side side,
+                                               SideStats& stats) {
+    // Раз в CHECK_PERIOD шагов сторона сверяется с общими счетчиками и ограничениями.
+    long long unreported = 0;
+    Position::MoveList moves;
+    while ( !opened_set.Empty() && (stop_.load( std::memory_order_relaxed) == RUNNING) ) {
+        ++stats.expanded;
+        if ( ++unreported == CHECK_PERIOD ) {
+            unreported = 0;
+            if ( (side == SearchStats::SOURCE) && progress_ ) {
+                Report();
+            }
+            if ( shared_nodes_.fetch_add( CHECK_PERIOD) + CHECK_PERIOD >= budget_.NodeLimit() ) {
+                Interrupt( NODE_LIMIT);
+                break;
+            }
+            shared_bytes_[side].store( arena.Capacity() + pool.Capacity(), std::memory_order_relaxed);
+            StopReason reason = budget_.Check( shared_bytes_[SearchStats::SOURCE].load( std::memory_order_relaxed)
+                                               + shared_bytes_[SearchStats::GOAL].load( std::memory_order_relaxed));
+            if ( reason != NOT_STOPPED ) {
+                Interrupt( reason);
+                break;
+            }
+        }
+        NodeIndex current = opened_set.ExtractMin();
+        Position position = arena[current].position;
+        if ( other.MayContain( position.Hash()) ) {
+            // Вершина возвращается в очередь, чтобы при ложной встрече поиск
+            // можно было продолжить с того же состояния.
+            opened_set.Insert( current);
+            return StopSearch( MET) ? current : NO_NODE;
+        }
+        {
+            ProfileScope scope( stats.move_generation_seconds);
+            position.GetPossibleMoves( neighbors_, moves);
+        }
+        stats.generated += moves.Size();
+        for ( int index = 0; index < moves.Size(); ++index ) {
+            const Position::Move* move = &moves[index];
+            position.Swap( move->from, move->to);
+            int cost = arena[current].cost + 1;
+            NodeIndex next_vertex;
+            {
+                ProfileScope scope( stats.lookup_seconds);
+                next_vertex = pool.Find( position);
+            }
+            if ( next_vertex == NO_NODE ) {
+                int h;
+                {
+                    ProfileScope scope( stats.heuristic_seconds);
+                    h = heuristic.UpdateDistance( position, arena[current].h, move->from, move->to);
+                }
+                ++stats.heuristic_evaluations;
+                next_vertex = arena.Allocate( position, cost, h, h + cost, current);
+                pool.Insert( next_vertex);
+                own.Insert( position.Hash());
+                opened_set.Insert( next_vertex);
+            } else {
+                ++stats.duplicates;
+                if ( opened_set.Contains( next_vertex) && (arena[next_vertex].cost > cost) ) {
+                    ++stats.reopened;
+                    opened_set.DecreaseKey( next_vertex, cost);
+                    arena[next_vertex].parent = current;
+                }
+            }
+            position.Swap( move->from, move->to);
+        }
+        stats.peak_opened = std::max( stats.peak_opened, opened_set.Size());
+    }
+    return NO_NODE;
+}
+
+std::pair<bool, NodeIndex> AStarSearcher::SideSearch( VertexArena& arena, OpenedSet& opened_set, VertexPool& pool, Position& goal, VertexPool& check,
+                                                      const Heuristic& heuristic, SideStats& stats) {
     int step = 0;
     ++step;
-    VertexPtr current;
+    NodeIndex current;
+    Position::MoveList moves;
     while ( !opened_set.Empty() ) {
         if ( !(step % ITERATION_COUNT) ) {
-            return std::make_pair(false, VertexPtr());
+            return std::make_pair(false, NO_NODE);
+        }
+        if ( stats_.Expanded() >= budget_.NodeLimit() ) {
+            interrupted_ = NODE_LIMIT;
+            return std::make_pair(false, NO_NODE);
+        }
+        if ( !(step % CHECK_PERIOD) ) {
+            interrupted_ = budget_.Check( MemoryUsage());
+            if ( interrupted_ != NOT_STOPPED ) {
+                return std::make_pair(false, NO_NODE);
+            }
         }
         step++;
+        ++stats.expanded;
         current = opened_set.ExtractMin();
-        Position position = current->position;
-        if ( (position == goal) || (check.Find( position).use_count()) ) {
+        Position position = arena[current].position;
+        if ( (position == goal) || (check.Find( position) != NO_NODE) ) {
             return std::make_pair(true, current);
         }
-        std::vector<Position::Move> moves = position.GetPossibleMoves();
-        for ( std::vector<Position::Move>::iterator move = moves.begin(); move != moves.end(); ++move ) {
+        {
+            ProfileScope scope( stats.move_generation_seconds);
+            position.GetPossibleMoves( neighbors_, moves);
+        }
+        stats.generated += moves.Size();
+        for ( int index = 0; index < moves.Size(); ++index ) {
+            const Position::Move* move = &moves[index];
             position.Swap( move->from, move->to);
-            int cost = current->cost + 1;
-            VertexPtr next_vertex = pool.Find( position);
-            if ( !next_vertex.use_count() ) {
-                int h = position.UpdateDistance( goal, current->h, move->from, move->to);
-                next_vertex.reset( new Vertex( position, cost, h, h + cost, current));
+            int cost = arena[current].cost + 1;
+            NodeIndex next_vertex;
+            {
+                ProfileScope scope( stats.lookup_seconds);
+                next_vertex = pool.Find( position);
+            }
+            if ( next_vertex == NO_NODE ) {
+                int h;
+                {
+                    ProfileScope scope( stats.heuristic_seconds);
+                    h = heuristic.UpdateDistance( position, arena[current].h, move->from, move->to);
+                }
+                ++stats.heuristic_evaluations;
+                next_vertex = arena.Allocate( position, cost, h, h + cost, current);
                 pool.Insert( next_vertex);
                 opened_set.Insert( next_vertex);
-            } else if ( opened_set.FindAndErase( next_vertex)) {
-                if ( next_vertex->cost > cost ) {
-                    next_vertex->heuristic = next_vertex->h + cost;
-                    next_vertex->cost = cost;
-                    next_vertex->parent = current;
+            } else {
+                ++stats.duplicates;
+                if ( opened_set.Contains( next_vertex) && (arena[next_vertex].cost > cost) ) {
+                    ++stats.reopened;
+                    opened_set.DecreaseKey( next_vertex, cost);
+                    arena[next_vertex].parent = current;
                 }
-                opened_set.Insert( next_vertex);
             }
             position.Swap( move->from, move->to);
         }
+        stats.peak_opened = std::max( stats.peak_opened, opened_set.Size());
     }
-    return std::make_pair(false, VertexPtr());
+    return std::make_pair(false, NO_NODE);
 }
 
 
@@ -127,55 +579,113 @@ std::vector<Position> AStarSearcher::Search( const Position& source_, const Posi
 	error_msg = "";
 	std::vector<Position> way;
     Position source = source_, goal = goal_;
-    if ( !goal.IsSimular( source) ) {
-        error_msg = "Positions not simular";
-		return way;
-    }
-    OpenedSet opened_set_source;
-    VertexPool pool_source;
-    int dist = source.Distance( goal);
-    VertexPtr source_vertex( new Vertex( source, 0, dist, dist, VertexPtr()));
-    pool_source.Insert( source_vertex);
-    opened_set_source.Insert( source_vertex);
-    OpenedSet opened_set_goal;
-    VertexPool pool_goal;
-    dist = goal.Distance( source);
-    VertexPtr goal_vertex( new Vertex( goal, 0, dist, dist, VertexPtr()));
-    pool_goal.Insert( goal_vertex);
-    opened_set_goal.Insert( goal_vertex);
-    std::pair<bool, VertexPtr> search_result;
-    VertexPtr source_end, goal_end;
-	long long iteration = 0;
-    while (iteration < limit) {
-        search_result = SideSearch( opened_set_source, pool_source, goal, pool_goal);
+    stats_.Clear();
+    partial_.clear();
+    if ( !CheckReachability( source, goal, error_msg) ) {
+        return way;
+    }
+    Reset();
+    start_ = std::chrono::steady_clock::now();
+    budget_.Start( control_, limit, time_limit_);
+    interrupted_ = NOT_STOPPED;
+    bool exhausted = false;
+    neighbors_ = NeighborTable( source);
+    std::unique_ptr<Heuristic> source_heuristic = PrepareHeuristic( heuristic_, goal);
+    std::unique_ptr<Heuristic> goal_heuristic = PrepareHeuristic( heuristic_, source);
+    int dist = source_heuristic->Distance( source);
+    NodeIndex source_vertex = arena_source_.Allocate( source, 0, dist, dist, NO_NODE);
+    pool_source_.Insert( source_vertex);
+    opened_set_source_.Insert( source_vertex);
+    dist = goal_heuristic->Distance( goal);
+    NodeIndex goal_vertex = arena_goal_.Allocate( goal, 0, dist, dist, NO_NODE);
+    pool_goal_.Insert( goal_vertex);
+    opened_set_goal_.Insert( goal_vertex);
+    stats_.sides[SearchStats::SOURCE].heuristic_evaluations = 1;
+    stats_.sides[SearchStats::GOAL].heuristic_evaluations = 1;
+    std::pair<bool, NodeIndex> search_result;
+    NodeIndex source_end = NO_NODE, goal_end = NO_NODE;
+    if ( concurrent_ ) {
+        shared_source_.Insert( source.Hash());
+        shared_goal_.Insert( goal.Hash());
+        stop_ = RUNNING;
+        shared_nodes_ = 0;
+        shared_bytes_[SearchStats::SOURCE] = 0;
+        shared_bytes_[SearchStats::GOAL] = 0;
+        // Счетчики стороны цели ведутся отдельно, чтобы Report из потока
+        // стороны начальной позиции не читал их одновременно с записью.
+        SideStats goal_stats = stats_.sides[SearchStats::GOAL];
+        NodeIndex goal_meet = NO_NODE;
+        std::thread goal_thread( [&]() {
+            goal_meet = ConcurrentSideSearch( arena_goal_, opened_set_goal_, pool_goal_, shared_goal_, shared_source_, *goal_heuristic,
+                                              SearchStats::GOAL, goal_stats);
+        });
+        NodeIndex source_meet = ConcurrentSideSearch( arena_source_, opened_set_source_, pool_source_, shared_source_, shared_goal_,
+                                                      *source_heuristic, SearchStats::SOURCE, stats_.sides[SearchStats::SOURCE]);
+        goal_thread.join();
+        stats_.sides[SearchStats::GOAL] = goal_stats;
+        if ( source_meet != NO_NODE ) {
+            goal_end = pool_goal_.Find( arena_source_[source_meet].position);
+            source_end = (goal_end == NO_NODE) ? NO_NODE : source_meet;
+        } else if ( goal_meet != NO_NODE ) {
+            source_end = pool_source_.Find( arena_goal_[goal_meet].position);
+            goal_end = (source_end == NO_NODE) ? NO_NODE : goal_meet;
+        }
+        exhausted = (stop_ == RUNNING);
+    }
+    // Поочередный поиск; после одновременного - только при ложной встрече.
+    while ( (source_end == NO_NODE) && (interrupted_ == NOT_STOPPED) && !exhausted ) {
+        search_result = SideSearch( arena_source_, opened_set_source_, pool_source_, goal, pool_goal_, *source_heuristic,
+                                    stats_.sides[SearchStats::SOURCE]);
         if ( search_result.first ) {
             source_end = search_result.second;
-            goal_end = pool_goal.Find( source_end->position);
+            goal_end = pool_goal_.Find( arena_source_[source_end].position);
             break;
         }
-		iteration += ITERATION_COUNT;
-        search_result = SideSearch( opened_set_goal, pool_goal, source, pool_source);
+        if ( interrupted_ != NOT_STOPPED ) {
+            break;
+        }
+        search_result = SideSearch( arena_goal_, opened_set_goal_, pool_goal_, source, pool_source_, *goal_heuristic,
+                                    stats_.sides[SearchStats::GOAL]);
         if ( search_result.first ) {
             goal_end = search_result.second;
-            source_end = pool_source.Find( goal_end->position);
+            source_end = pool_source_.Find( arena_goal_[goal_end].position);
             break;
         }
-		iteration += ITERATION_COUNT;
+        // Сторона, исчерпавшая очередь без встречи, обошла всю свою компоненту.
+        exhausted = opened_set_source_.Empty() || opened_set_goal_.Empty();
+        if ( progress_ ) {
+            Report();
+        }
     }
-	if (iteration >= limit) {
-		error_msg = "Limit exceed";
-		return way;
-	}        
-
-    while ( source_end.use_count() ) {
-        way.push_back( source_end->position);
-        source_end = source_end->parent;
+    stats_.sides[SearchStats::SOURCE].closed = pool_source_.Size() - opened_set_source_.Size();
+    stats_.sides[SearchStats::GOAL].closed = pool_goal_.Size() - opened_set_goal_.Size();
+    stats_.seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    if ( source_end == NO_NODE ) {
+        if ( interrupted_ != NOT_STOPPED ) {
+            error_msg = StopMessage( interrupted_);
+            for ( NodeIndex vertex = BestOpened( arena_source_); vertex != NO_NODE; vertex = arena_source_[vertex].parent ) {
+                partial_.push_back( arena_source_[vertex].position);
+            }
+            std::reverse( partial_.begin(), partial_.end());
+        } else {
+            error_msg = "No solution";
+        }
+    } else {
+        while ( source_end != NO_NODE ) {
+            way.push_back( arena_source_[source_end].position);
+            source_end = arena_source_[source_end].parent;
+        }
+        std::reverse( way.begin(), way.end());
+        goal_end = arena_goal_[goal_end].parent;
+        while ( goal_end != NO_NODE ) {
+            way.push_back( arena_goal_[goal_end].position);
+            goal_end = arena_goal_[goal_end].parent;
+        }
     }
-    std::reverse( way.begin(), way.end());
-    goal_end = goal_end->parent;
-    while ( goal_end.use_count() ) {
-        way.push_back( goal_end->position);
-        goal_end = goal_end->parent;
+    if ( reuse_arena_ ) {
+        Reset();
+    } else {
+        Release();
     }
     return way;
 }
@@ -2,64 +2,251 @@
 #ifndef _SEARCH_H_
 #define _SEARCH_H_
 
-#include <boost/shared_ptr.hpp>
+#include <stdint.h>
 #include <vector>
 #include <map>
-#include <set>
+#include <string>
 #include <utility>
+#include <chrono>
+#include <mutex>
+#include <atomic>
 #include "position.h"
+#include "heuristic.h"
+#include "search_stats.h"
+#include "search_control.h"
 
-struct Vertex;
-typedef boost::shared_ptr<Vertex> VertexPtr;
+// Номер вершины в VertexArena.
+typedef uint32_t NodeIndex;
+const NodeIndex NO_NODE = NodeIndex( -1);
 
 struct Vertex {
     Vertex();
-	Vertex( const Position& position_, int cost_, int h_, int heuristic_, const VertexPtr& parent_);
+	Vertex( const Position& position_, int cost_, int h_, int heuristic_, NodeIndex parent_);
     Position position;
     int cost;
     int h;
     int heuristic;
-    VertexPtr parent;
+    NodeIndex parent;
+    // Положение в OpenedSet: соседи по корзине и признак нахождения в ней.
+    NodeIndex open_prev;
+    NodeIndex open_next;
+    bool opened;
 };
 
-
-class PoolCompare {
+// Хранилище вершин одного поиска: куски по CHUNK_SIZE вершин, адресуемых
+// 32-битными номерами. Вершины не удаляются по одной, Clear освобождает все
+// сразу, оставляя куски для следующего поиска, Release возвращает память.
+class VertexArena {
 public:
-    bool operator()( const VertexPtr& operand1, const VertexPtr& operand2) const;
+    VertexArena();
+    ~VertexArena();
+    NodeIndex Allocate( const Position& position, int cost, int h, int heuristic, NodeIndex parent);
+    Vertex& operator[]( NodeIndex index) {
+        return chunks_[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+    }
+    const Vertex& operator[]( NodeIndex index) const {
+        return chunks_[index >> CHUNK_BITS][index & (CHUNK_SIZE - 1)];
+    }
+    size_t Size() const {return size_;}
+    // Занятая кусками память в байтах.
+    size_t Capacity() const {return chunks_.size() * CHUNK_SIZE * sizeof( Vertex);}
+    // Память кусков после размещения еще count вершин.
+    size_t CapacityAfter( size_t count) const;
+    void Clear();
+    void Release();
+    enum { CHUNK_BITS = 12, CHUNK_SIZE = 1 << CHUNK_BITS };
+private:
+    VertexArena( const VertexArena&);
+    VertexArena& operator=( const VertexArena&);
+    std::vector<Vertex*> chunks_;
+    size_t size_;
+    // Число вершин, позиции которых хранят поле в vector<int> и требуют деструктора.
+    size_t wide_count_;
 };
 
+// Множество вершин с открытой адресацией и линейным пробированием по хешу позиции.
+// Поиск выполняется непосредственно по Position, без создания временной вершины.
 class VertexPool {
 public:
-    typedef std::set<VertexPtr, PoolCompare> Pool; 
-    VertexPtr Find( const Position& position);
-    void Insert( const VertexPtr& vertex);
+    explicit VertexPool( const VertexArena& arena);
+    NodeIndex Find( const Position& position) const;
+    void Insert( NodeIndex vertex);
+    // Готовит таблицу к хранению count вершин без перестроений.
+    void Reserve( size_t count);
+    void Clear();
+    void Release();
+    size_t Size() const {return size_;}
+    // Занятая таблицей память в байтах.
+    size_t Capacity() const {return slots_.size() * sizeof( Slot);}
+    // Наибольшая память таблицы при вставке еще count вершин: при
+    // перестроении старая и новая таблицы существуют одновременно.
+    size_t PeakCapacity( size_t count) const;
+    double LoadFactor() const;
+    const static double MAX_LOAD_FACTOR;
 private:
-    Pool pool_;
+    struct Slot {
+        Slot() : hash( 0), vertex( NO_NODE) {}
+        uint64_t hash;
+        NodeIndex vertex;
+    };
+    void Rehash( size_t capacity);
+    const VertexArena& arena_;
+    std::vector<Slot> slots_;
+    size_t size_;
 };
 
-class OpenedSetCompare {
+// Очередь с приоритетами на корзинах: вершины разложены по значению heuristic,
+// а внутри - по cost, из равных по heuristic первой извлекается вершина с
+// большим cost. Корзина - двусвязный список через поля open_prev/open_next вершины.
+class OpenedSet {
 public:
-    bool operator()( const VertexPtr& operand1, const VertexPtr& operand2) const;
+    explicit OpenedSet( VertexArena& arena);
+    bool Contains( NodeIndex vertex) const {return arena_[vertex].opened;}
+    void Insert( NodeIndex vertex);
+    // Уменьшает стоимость вершины, находящейся в очереди, перенося ее в новую корзину.
+    void DecreaseKey( NodeIndex vertex, int cost);
+    // Убирает вершину из очереди, например чтобы вставить с другим heuristic.
+    void Remove( NodeIndex vertex);
+    NodeIndex ExtractMin();
+    // Наименьшее значение heuristic в непустой очереди.
+    int MinHeuristic();
+    void Clear();
+    void Release();
+    bool Empty() const {return !size_;}
+    size_t Size() const {return size_;}
+    // Число вершин в очереди для каждого значения heuristic.
+    const std::vector<size_t>& Occupancy() const {return occupancy_;}
+    // Занятая корзинами память в байтах.
+    size_t Capacity() const {return capacity_;}
+private:
+    void Link( NodeIndex vertex);
+    void Unlink( NodeIndex vertex);
+    VertexArena& arena_;
+    std::vector< std::vector<NodeIndex> > buckets_;
+    std::vector<size_t> occupancy_;
+    // Верхняя граница cost непустых корзин для каждого heuristic.
+    std::vector<int> max_cost_;
+    size_t min_heuristic_;
+    size_t size_;
+    size_t capacity_;
 };
 
-class OpenedSet {
+// Вершина очереди с наименьшим h (из равных - с наименьшим cost) среди
+// вершин арены, NO_NODE, если в очереди нет вершин. Просматривает всю арену.
+NodeIndex BestOpened( const VertexArena& arena);
+
+// Множество хешей позиций для одновременного доступа из нескольких потоков:
+// SHARD_COUNT независимых таблиц с открытой адресацией, каждая под своим
+// мьютексом; таблица выбирается по старшим битам хеша. Хранятся только хеши
+// (8 байт на позицию), поэтому MayContain изредка ошибается в сторону true.
+class SharedHashSet {
 public:
-    typedef std::set<VertexPtr, OpenedSetCompare> Set;
-    bool FindAndErase( const VertexPtr& vertex);
-    void Insert( const VertexPtr& vertex);
-    VertexPtr ExtractMin();
-    bool Empty();
+    SharedHashSet() {}
+    void Insert( uint64_t hash);
+    bool MayContain( uint64_t hash) const;
+    // Clear и Release нельзя вызывать одновременно с Insert и MayContain.
+    void Clear();
+    void Release();
+    enum { SHARD_BITS = 6, SHARD_COUNT = 1 << SHARD_BITS };
 private:
-    Set set_;
-
+    SharedHashSet( const SharedHashSet&);
+    SharedHashSet& operator=( const SharedHashSet&);
+    // Слоты хранят хеш с единичным младшим битом, 0 - пустой слот.
+    struct Shard {
+        Shard() : size( 0) {}
+        mutable std::mutex mutex;
+        std::vector<uint64_t> tags;
+        size_t size;
+    };
+    static size_t ShardIndex( uint64_t hash) {return size_t( hash >> (64 - SHARD_BITS));}
+    static uint64_t Tag( uint64_t hash) {return hash | 1;}
+    static void Grow( Shard& shard);
+    Shard shards_[SHARD_COUNT];
 };
 
+// Двунаправленный A*, останавливающийся при первой встрече сторон. Найденный
+// путь обычно близок к кратчайшему, но это не гарантируется; кратчайший путь
+// двунаправленным поиском находит MMSearcher.
 class AStarSearcher {
 public:
+    AStarSearcher();
+    // Сохранять ли память арен и таблиц между вызовами Search.
+    void SetReuseArena( bool reuse) {reuse_arena_ = reuse;}
+    // Прототип оценки расстояния для обеих сторон поиска. Если оценка не
+    // применима к цели стороны (или не задана), используется манхэттенская.
+    void SetHeuristic( const Heuristic* heuristic) {heuristic_ = heuristic;}
+    // Вести поиск со стороны цели в отдельном потоке одновременно с поиском
+    // со стороны начальной позиции. Стороны публикуют хеши найденных позиций
+    // в SharedHashSet, проверяемые противоположной стороной, и останавливаются
+    // по общему флагу. Встреча проверяется по VertexPool после остановки, при
+    // совпадении одних хешей поиск продолжается поочередно.
+    void SetConcurrent( bool concurrent) {concurrent_ = concurrent;}
+    // Ограничение времени одного вызова Search в секундах, 0 - без ограничения.
+    void SetTimeLimit( double seconds) {time_limit_ = seconds;}
+    // Внешние ограничения и отмена, 0 - нет. Память учитывает арены и пулы обеих сторон.
+    void SetControl( const SearchControl* control) {control_ = control;}
+    // Число раскрытых вершин в последнем вызове Search.
+    long long NodesExpanded() const {return stats_.Expanded();}
+    // Статистика последнего вызова Search по сторонам SOURCE и GOAL.
+    const SearchStats& Stats() const {return stats_;}
+    // Вызывается после каждой пары порций поочередного поиска, а в
+    // одновременном - из потока стороны SOURCE раз в 1024 раскрытия; счетчики
+    // стороны GOAL в этом случае заполняются только после остановки.
+    void SetProgress( const ProgressCallback& progress) {progress_ = progress;}
+    // limit - ограничение на суммарное число раскрытых вершин обеих сторон.
     std::vector<Position> Search( const Position& source, const Position& goal, long long limit, std::string& error_msg);
-    std::pair<bool, VertexPtr> SideSearch( OpenedSet& opened_set, VertexPool& pool, Position& goal, VertexPool& check);
+    // Путь от начальной позиции до вершины очереди стороны SOURCE с
+    // наименьшей оценкой, если последний Search прерван ограничением или
+    // отменой; иначе пуст.
+    const std::vector<Position>& BestPartial() const {return partial_;}
+    std::pair<bool, NodeIndex> SideSearch( VertexArena& arena, OpenedSet& opened_set, VertexPool& pool, Position& goal, VertexPool& check,
+                                           const Heuristic& heuristic, SideStats& stats);
 	const static int ITERATION_COUNT;
+private:
+    AStarSearcher( const AStarSearcher&);
+    AStarSearcher& operator=( const AStarSearcher&);
+    void Reset();
+    void Release();
+    // Причина остановки одновременного поиска; при INTERRUPTED подробности в interrupted_.
+    enum Stop { RUNNING, MET, INTERRUPTED };
+    // Одна сторона одновременного поиска; работает до встречи, остановки или
+    // исчерпания своей очереди. Возвращает вершину предполагаемой встречи
+    // (оставленную в очереди) или NO_NODE. Сторона SOURCE вызывает progress_.
+    NodeIndex ConcurrentSideSearch( VertexArena& arena, OpenedSet& opened_set, VertexPool& pool, SharedHashSet& own,
+                                    const SharedHashSet& other, const Heuristic& heuristic, SearchStats::Side side, SideStats& stats);
+    void Report();
+    // Переводит поиск из RUNNING в reason; false, если он уже остановлен.
+    bool StopSearch( Stop reason);
+    // Останавливает одновременный поиск по ограничению reason.
+    void Interrupt( StopReason reason);
+    // Память арен и пулов обеих сторон в байтах.
+    size_t MemoryUsage() const;
+    bool reuse_arena_;
+    bool concurrent_;
+    const Heuristic* heuristic_;
+    double time_limit_;
+    const SearchControl* control_;
+    SearchBudget budget_;
+    // Причина остановки последнего поиска, NOT_STOPPED - нет.
+    StopReason interrupted_;
+    std::vector<Position> partial_;
+    SearchStats stats_;
+    ProgressCallback progress_;
+    std::chrono::steady_clock::time_point start_;
+    NeighborTable neighbors_;
+    VertexArena arena_source_;
+    VertexArena arena_goal_;
+    VertexPool pool_source_;
+    VertexPool pool_goal_;
+    OpenedSet opened_set_source_;
+    OpenedSet opened_set_goal_;
+    SharedHashSet shared_source_;
+    SharedHashSet shared_goal_;
+    std::atomic<int> stop_;
+    // Число вершин, раскрытых обеими сторонами, обновляется порциями.
+    std::atomic<long long> shared_nodes_;
+    // Память каждой стороны одновременного поиска, обновляется порциями.
+    std::atomic<size_t> shared_bytes_[SearchStats::SIDE_COUNT];
 };
 
 #endif /* _SEARCH_H_ */
-
@@ -0,0 +1,66 @@
+#include "search_control.h"
+#include <algorithm>
+
+std::string StopMessage( StopReason reason) {
+    switch ( reason ) {
+        case NODE_LIMIT:
+            return "Limit exceed";
+        case TIME_LIMIT:
+            return "Time limit exceed";
+        case MEMORY_LIMIT:
+            return "Memory limit exceed";
+        case CANCELLED:
+            return "Cancelled";
+        default:
+            return "";
+    }
+}
+
+SearchControl::SearchControl()
+    : has_deadline_( false), node_budget_( 0), memory_budget_( 0), cancelled_( false) {
+}
+
+void SearchControl::SetTimeout( double seconds) {
+    SetDeadline( std::chrono::steady_clock::now()
+                 + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( seconds)));
+    return;
+}
+
+SearchBudget::SearchBudget()
+    : control_( 0), node_limit_( 0), has_deadline_( false), memory_limit_( 0) {
+}
+
+void SearchBudget::Start( const SearchControl* control, long long limit, double time_limit) {
+    control_ = control;
+    node_limit_ = limit;
+    has_deadline_ = (time_limit > 0);
+    if ( has_deadline_ ) {
+        deadline_ = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>( std::chrono::duration<double>( time_limit));
+    }
+    memory_limit_ = 0;
+    if ( control_ ) {
+        if ( control_->node_budget_ > 0 ) {
+            node_limit_ = std::min( node_limit_, control_->node_budget_);
+        }
+        if ( control_->has_deadline_ ) {
+            deadline_ = has_deadline_ ? std::min( deadline_, control_->deadline_) : control_->deadline_;
+            has_deadline_ = true;
+        }
+        memory_limit_ = control_->memory_budget_;
+    }
+    return;
+}
+
+StopReason SearchBudget::Check( size_t bytes) const {
+    if ( control_ && control_->Cancelled() ) {
+        return CANCELLED;
+    }
+    if ( memory_limit_ && (bytes > memory_limit_) ) {
+        return MEMORY_LIMIT;
+    }
+    if ( has_deadline_ && (std::chrono::steady_clock::now() >= deadline_) ) {
+        return TIME_LIMIT;
+    }
+    return NOT_STOPPED;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef _SEARCH_CONTROL_H_
+#define _SEARCH_CONTROL_H_
+
+#include <stddef.h>
+#include <chrono>
+#include <atomic>
+#include <string>
+
+// Причина остановки поиска до его завершения.
+enum StopReason { NOT_STOPPED, NODE_LIMIT, TIME_LIMIT, MEMORY_LIMIT, CANCELLED };
+
+// Текст error_msg для причины остановки.
+std::string StopMessage( StopReason reason);
+
+// Внешние ограничения поиска: крайний срок, число раскрытых вершин, память
+// и флаг отмены. Задается поиску через SetControl и должен жить до конца
+// Search. Cancel можно вызывать из любого потока во время поиска; остальные
+// настройки меняются только между вызовами Search. Ограничения действуют
+// вместе с собственными ограничениями поиска (limit и SetTimeLimit).
+class SearchControl {
+public:
+    SearchControl();
+    void SetDeadline( std::chrono::steady_clock::time_point deadline) {deadline_ = deadline; has_deadline_ = true;}
+    // Крайний срок через seconds от текущего момента.
+    void SetTimeout( double seconds);
+    void ClearDeadline() {has_deadline_ = false;}
+    // 0 - без ограничения.
+    void SetNodeBudget( long long nodes) {node_budget_ = nodes;}
+    // Ограничение памяти вершин и таблиц поиска в байтах, 0 - без ограничения.
+    void SetMemoryBudget( size_t bytes) {memory_budget_ = bytes;}
+    void Cancel() {cancelled_.store( true, std::memory_order_relaxed);}
+    // Снимает отмену для следующего поиска.
+    void Reset() {cancelled_.store( false, std::memory_order_relaxed);}
+    bool Cancelled() const {return cancelled_.load( std::memory_order_relaxed);}
+private:
+    SearchControl( const SearchControl&);
+    SearchControl& operator=( const SearchControl&);
+    friend class SearchBudget;
+    bool has_deadline_;
+    std::chrono::steady_clock::time_point deadline_;
+    long long node_budget_;
+    size_t memory_budget_;
+    std::atomic<bool> cancelled_;
+};
+
+// Раз в столько раскрытий поиски сверяются с SearchBudget::Check и вызывают
+// обратный вызов прогресса.
+const int CHECK_PERIOD = 1024;
+
+// Ограничения одного вызова Search: собственные ограничения поиска,
+// объединенные с SearchControl. Проверка - одно чтение атомарного флага, два
+// сравнения и, при заданном сроке, чтение часов; поиски выполняют ее раз в
+// сотни или тысячи раскрытий.
+class SearchBudget {
+public:
+    SearchBudget();
+    // control может быть 0; time_limit в секундах, 0 - без ограничения.
+    void Start( const SearchControl* control, long long limit, double time_limit);
+    // Наименьшее из ограничений на число раскрытых вершин.
+    long long NodeLimit() const {return node_limit_;}
+    // Ограничение памяти из SearchControl в байтах, 0 - нет.
+    size_t MemoryLimit() const {return memory_limit_;}
+    // Причина остановки по отмене, сроку или памяти bytes; NOT_STOPPED, если поиск можно продолжать.
+    StopReason Check( size_t bytes) const;
+private:
+    const SearchControl* control_;
+    long long node_limit_;
+    bool has_deadline_;
+    std::chrono::steady_clock::time_point deadline_;
+    size_t memory_limit_;
+};
+
+#endif /* _SEARCH_CONTROL_H_ */
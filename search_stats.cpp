@@ -0,0 +1,32 @@
+#include "search_stats.h"
+
+SideStats::SideStats()
+    : expanded( 0), generated( 0), duplicates( 0), reopened( 0), heuristic_evaluations( 0), peak_opened( 0), closed( 0),
+      move_generation_seconds( 0), heuristic_seconds( 0), lookup_seconds( 0) {
+}
+
+void SideStats::Add( const SideStats& other) {
+    expanded += other.expanded;
+    generated += other.generated;
+    duplicates += other.duplicates;
+    reopened += other.reopened;
+    heuristic_evaluations += other.heuristic_evaluations;
+    // Пики сторон и потоков достигаются в разное время, так что сумма - оценка сверху.
+    peak_opened += other.peak_opened;
+    closed += other.closed;
+    move_generation_seconds += other.move_generation_seconds;
+    heuristic_seconds += other.heuristic_seconds;
+    lookup_seconds += other.lookup_seconds;
+    return;
+}
+
+void SearchStats::Clear() {
+    *this = SearchStats();
+    return;
+}
+
+SideStats SearchStats::Total() const {
+    SideStats total = sides[SOURCE];
+    total.Add( sides[GOAL]);
+    return total;
+}
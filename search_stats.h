@@ -0,0 +1,71 @@
+#pragma once
+#ifndef _SEARCH_STATS_H_
+#define _SEARCH_STATS_H_
+
+#include <stddef.h>
+#include <chrono>
+#include <functional>
+
+// Счетчики одной стороны поиска (у однонаправленных поисков сторона одна).
+// Счетчики - простые приращения в уже выполняемых ветвях; время по этапам
+// измеряется только при сборке с SEARCH_PROFILE.
+struct SideStats {
+    SideStats();
+    void Add( const SideStats& other);
+    // Вершины, извлеченные из очереди.
+    long long expanded;
+    // Позиции, порожденные ходами.
+    long long generated;
+    // Порожденные позиции, уже бывшие в пуле.
+    long long duplicates;
+    // Вершины пула, получившие путь короче.
+    long long reopened;
+    // Вызовы Distance и UpdateDistance.
+    long long heuristic_evaluations;
+    // Наибольший размер очереди (для IDA* - наибольшая глубина пути).
+    size_t peak_opened;
+    // Число закрытых вершин при остановке поиска.
+    size_t closed;
+    // Время генерации ходов, вычисления оценки и поиска в пуле, секунды.
+    double move_generation_seconds;
+    double heuristic_seconds;
+    double lookup_seconds;
+};
+
+// Статистика последнего вызова Search любого из поисков.
+struct SearchStats {
+    SearchStats() : seconds( 0) {}
+    void Clear();
+    // Сумма по сторонам.
+    SideStats Total() const;
+    long long Expanded() const {return sides[SOURCE].expanded + sides[GOAL].expanded;}
+    enum Side { SOURCE, GOAL, SIDE_COUNT };
+    SideStats sides[SIDE_COUNT];
+    // Полное время поиска.
+    double seconds;
+};
+
+// Периодически вызывается из потока поиска с текущей статистикой.
+typedef std::function<void( const SearchStats& stats)> ProgressCallback;
+
+// Прибавляет к total время жизни объекта при сборке с SEARCH_PROFILE;
+// без нее объект пуст и не порождает кода.
+class ProfileScope {
+public:
+#ifdef SEARCH_PROFILE
+    explicit ProfileScope( double& total) : total_( total), start_( std::chrono::steady_clock::now()) {}
+    ~ProfileScope() {
+        total_ += std::chrono::duration<double>( std::chrono::steady_clock::now() - start_).count();
+    }
+private:
+    double& total_;
+    std::chrono::steady_clock::time_point start_;
+#else
+    explicit ProfileScope( double&) {}
+#endif
+private:
+    ProfileScope( const ProfileScope&);
+    ProfileScope& operator=( const ProfileScope&);
+};
+
+#endif /* _SEARCH_STATS_H_ */
@@ -0,0 +1,219 @@
+#include "solution.h"
+#include <stdexcept>
+
+const char SOLUTION_MAGIC[8] = {'1', '5', 'S', 'O', 'L', '\n', 0, 0};
+
+Solution::Solution()
+    : empty_( true), length_( 0), blank_( NO_BLANK), last_blank_( NO_BLANK), cursor_step_( 0), cursor_blank_( NO_BLANK) {
+}
+
+Solution::Solution( const Position& source)
+    : source_( source), empty_( false), length_( 0), blank_( NO_BLANK), last_blank_( NO_BLANK), cursor_( source),
+      cursor_step_( 0), cursor_blank_( NO_BLANK) {
+    int blanks = 0;
+    for ( int index = 0; index < source.Height() * source.Width(); ++index ) {
+        if ( source.GetField( index) == Position::BLANK ) {
+            blank_ = index;
+            ++blanks;
+        }
+    }
+    if ( blanks != 1 ) {
+        blank_ = NO_BLANK;
+    }
+    last_blank_ = cursor_blank_ = blank_;
+}
+
+Solution Solution::FromWay( const std::vector<Position>& way) {
+    if ( way.empty() ) {
+        return Solution();
+    }
+    Solution solution( way.front());
+    int cells = way.front().Height() * way.front().Width();
+    for ( size_t step = 1; step < way.size(); ++step ) {
+        Position::Move move;
+        for ( int index = 0; index < cells; ++index ) {
+            if ( way[step - 1].GetField( index) != way[step].GetField( index) ) {
+                // Фишка переходит из move.from на пустое место move.to.
+                if ( way[step - 1].GetField( index) == Position::BLANK ) {
+                    move.to = index;
+                } else {
+                    move.from = index;
+                }
+            }
+        }
+        solution.Append( move);
+    }
+    return solution;
+}
+
+Solution Solution::FromMoves( const Position& source, const std::vector<Position::Move>& moves) {
+    Solution solution( source);
+    for ( size_t index = 0; index < moves.size(); ++index ) {
+        solution.Append( moves[index]);
+    }
+    return solution;
+}
+
+int Solution::Target( int blank, Direction direction) const {
+    switch ( direction ) {
+    case UP:
+        return blank - source_.Width();
+    case RIGHT:
+        return blank + 1;
+    case DOWN:
+        return blank + source_.Width();
+    default:
+        return blank - 1;
+    }
+}
+
+void Solution::Append( const Position::Move& move) {
+    if ( IsPacked() ) {
+        int target = (move.from == last_blank_) ? move.to : move.from;
+        int width = source_.Width();
+        Direction direction = UP;
+        if ( target == last_blank_ + width ) {
+            direction = DOWN;
+        } else if ( (target == last_blank_ + 1) && (target % width) ) {
+            direction = RIGHT;
+        } else if ( (target == last_blank_ - 1) && (last_blank_ % width) ) {
+            direction = LEFT;
+        }
+#ifdef _DEBUG
+        if ( Target( last_blank_, direction) != target ) {
+            throw std::invalid_argument( "move");
+        }
+#endif
+        if ( !(length_ % 4) ) {
+            directions_.push_back( 0);
+        }
+        directions_.back() |= uint8_t( direction << (2 * (length_ % 4)));
+        last_blank_ = target;
+    } else {
+        const Position& current = At( length_);
+        if ( current.GetField( move.from) == Position::BLANK ) {
+            cells_.push_back( Position::Move( move.to, move.from));
+        } else {
+            cells_.push_back( move);
+        }
+    }
+    ++length_;
+    return;
+}
+
+Solution::Direction Solution::GetDirection( int step) const {
+    return Direction( (directions_[step / 4] >> (2 * (step % 4))) & 3);
+}
+
+Position::Move Solution::GetMove( int step, int& blank) const {
+    if ( !IsPacked() ) {
+        return cells_[step];
+    }
+    int target = Target( blank, GetDirection( step));
+    Position::Move move( target, blank);
+    blank = target;
+    return move;
+}
+
+Position::Move Solution::MoveAt( int step) const {
+    At( step);
+    int blank = cursor_blank_;
+    return GetMove( step, blank);
+}
+
+const Position& Solution::At( int step) const {
+    if ( step < cursor_step_ ) {
+        cursor_ = source_;
+        cursor_step_ = 0;
+        cursor_blank_ = blank_;
+    }
+    for ( ; cursor_step_ < step; ++cursor_step_ ) {
+        Position::Move move = GetMove( cursor_step_, cursor_blank_);
+        cursor_.Swap( move.from, move.to);
+    }
+    return cursor_;
+}
+
+std::vector<Position> Solution::Positions() const {
+    std::vector<Position> way;
+    if ( empty_ ) {
+        return way;
+    }
+    way.reserve( length_ + 1);
+    for ( int step = 0; step <= length_; ++step ) {
+        way.push_back( At( step));
+    }
+    return way;
+}
+
+std::string Solution::MoveString() const {
+    static const char LETTERS[] = {'U', 'R', 'D', 'L'};
+    std::string result;
+    if ( IsPacked() ) {
+        result.reserve( length_);
+        for ( int step = 0; step < length_; ++step ) {
+            result += LETTERS[GetDirection( step)];
+        }
+        return result;
+    }
+    for ( int step = 0; step < length_; ++step ) {
+        if ( step ) {
+            result += ' ';
+        }
+        result += std::to_string( cells_[step].from) + '-' + std::to_string( cells_[step].to);
+    }
+    return result;
+}
+
+SolutionWriter::SolutionWriter( std::ostream& output, Format format)
+    : output_( output), format_( format) {
+    if ( format_ == BINARY ) {
+        output_.write( SOLUTION_MAGIC, sizeof( SOLUTION_MAGIC));
+    }
+}
+
+void SolutionWriter::WriteInt( int32_t value) {
+    output_.write( reinterpret_cast<const char*>( &value), sizeof( value));
+    return;
+}
+
+void SolutionWriter::WriteLong( int64_t value) {
+    output_.write( reinterpret_cast<const char*>( &value), sizeof( value));
+    return;
+}
+
+void SolutionWriter::WriteString( const std::string& value) {
+    WriteInt( int32_t( value.size()));
+    output_.write( value.data(), value.size());
+    return;
+}
+
+void SolutionWriter::Write( const std::string& id, const std::string& status, bool solved, const Solution& solution, long long nodes, long long ms) {
+    int length = solved ? solution.Length() : -1;
+    if ( format_ == TEXT ) {
+        std::string moves = solution.MoveString();
+        output_ << id << ' ' << status << ' ' << length << ' ' << nodes << ' ' << ms << ' ' << (moves.empty() ? "-" : moves) << '\n';
+        return;
+    }
+    WriteString( id);
+    WriteString( status);
+    WriteInt( length);
+    WriteLong( nodes);
+    WriteLong( ms);
+    WriteInt( solution.Length());
+    WriteInt( solution.IsPacked() ? 1 : 0);
+    if ( solution.IsPacked() ) {
+        output_.write( reinterpret_cast<const char*>( solution.Directions().data()), solution.Directions().size());
+    } else {
+        for ( int step = 0; step < solution.Length(); ++step ) {
+            WriteInt( solution.Cells()[step].from);
+            WriteInt( solution.Cells()[step].to);
+        }
+    }
+    return;
+}
+
+void SolutionWriter::WriteError( const std::string& id, const std::string& status) {
+    Write( id, status, false, Solution(), 0, 0);
+    return;
+}
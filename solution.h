@@ -0,0 +1,100 @@
+#pragma once
+#ifndef _SOLUTION_H_
+#define _SOLUTION_H_
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <stdint.h>
+#include "position.h"
+
+// Решение в виде начальной позиции и последовательности ходов. Для поля с
+// одним пустым местом ход - направление движения пустого места, по 2 бита
+// на ход; иначе - пара номеров клеток. Промежуточные позиции не хранятся и
+// восстанавливаются проигрыванием ходов по запросу. At запоминает последнюю
+// восстановленную позицию, поэтому последовательный обход стоит O(1) на шаг,
+// но объект нельзя читать из нескольких потоков сразу.
+class Solution {
+public:
+    // Направления движения пустого места.
+    enum Direction { UP, RIGHT, DOWN, LEFT };
+    Solution();
+    explicit Solution( const Position& source);
+    // Решение по пути из последовательных позиций, соседние отличаются одним ходом.
+    static Solution FromWay( const std::vector<Position>& way);
+    static Solution FromMoves( const Position& source, const std::vector<Position::Move>& moves);
+    // Пустое решение - без начальной позиции; решение из одной позиции имеет длину 0.
+    bool Empty() const {return empty_;}
+    int Length() const {return length_;}
+    const Position& Source() const {return source_;}
+    // true, если ходы хранятся направлениями по 2 бита.
+    bool IsPacked() const {return blank_ != NO_BLANK;}
+    // Добавляет ход (обмен клеток move.from и move.to, одна из которых пуста);
+    // для упакованного решения вторая клетка - соседняя с пустым местом.
+    void Append( const Position::Move& move);
+    // Позиция после step ходов, 0 <= step <= Length().
+    const Position& At( int step) const;
+    // Направление хода step для упакованного решения.
+    Direction GetDirection( int step) const;
+    // Ход step: фишка переходит из from на пустое место to.
+    Position::Move MoveAt( int step) const;
+    // Все позиции пути, как возвращает Search.
+    std::vector<Position> Positions() const;
+    // Ходы в формате SolveBatch: буквы U, R, D, L или пары "откуда-куда".
+    std::string MoveString() const;
+    // Память ходов в байтах.
+    size_t MoveBytes() const {return directions_.capacity() + cells_.capacity() * sizeof( Position::Move);}
+    // Упакованные направления, 4 хода на байт, младшие биты - ранний ход.
+    const std::vector<uint8_t>& Directions() const {return directions_;}
+    const std::vector<Position::Move>& Cells() const {return cells_;}
+private:
+    enum { NO_BLANK = -1 };
+    // Клетка, в которую уходит пустое место из blank в направлении direction.
+    int Target( int blank, Direction direction) const;
+    // Ход step: откуда и куда сдвигается фишка; blank - пустое место перед
+    // ходом для упакованного решения, после хода оно в move.from.
+    Position::Move GetMove( int step, int& blank) const;
+    Position source_;
+    bool empty_;
+    int length_;
+    // Пустое место в source_ и в конце решения, NO_BLANK - ходы в cells_.
+    int blank_;
+    int last_blank_;
+    std::vector<uint8_t> directions_;
+    std::vector<Position::Move> cells_;
+    // Последняя восстановленная позиция.
+    mutable Position cursor_;
+    mutable int cursor_step_;
+    mutable int cursor_blank_;
+};
+
+// Потоковая запись результатов решения задач. Текстовый формат - строки
+// SolveBatch:
+//   id status length nodes ms moves
+// Двоичный начинается с SOLUTION_MAGIC, затем записи:
+//   int32 длина id, байты id, int32 длина status, байты status,
+//   int32 length (-1 без решения), int64 nodes, int64 ms, int32 число ходов
+//   count (ходы частичного пути, если length = -1), int32 1 - направления,
+//   0 - пары клеток, затем (count + 3) / 4 байт Solution::Directions() или
+//   по int32 откуда, int32 куда на ход.
+// Ходы нужны вместе с исходной позицией задачи, сама позиция не пишется.
+class SolutionWriter {
+public:
+    enum Format { TEXT, BINARY };
+    SolutionWriter( std::ostream& output, Format format);
+    // Ходы пишутся для непустого solution; при solved = false length = -1,
+    // а solution - частичный путь или пусто.
+    void Write( const std::string& id, const std::string& status, bool solved, const Solution& solution, long long nodes, long long ms);
+    // Ошибка разбора задачи: решения нет, nodes и ms нулевые.
+    void WriteError( const std::string& id, const std::string& status);
+    void Flush() {output_.flush();}
+private:
+    void WriteInt( int32_t value);
+    void WriteLong( int64_t value);
+    void WriteString( const std::string& value);
+    std::ostream& output_;
+    Format format_;
+};
+extern const char SOLUTION_MAGIC[8];
+
+#endif /* _SOLUTION_H_ */
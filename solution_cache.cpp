@@ -0,0 +1,262 @@
+#include "solution_cache.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const uint32_t SolutionCache::VERSION = 1;
+
+namespace {
+
+const char MAGIC[8] = {'1', '5', 'C', 'C', 'H', '\n', 0, 0};
+// Заголовок: MAGIC, VERSION, размер ячейки, число ячеек; выровнен до строки кэша.
+const size_t HEADER_SIZE = 64;
+const uint64_t USED_BIT = uint64_t( 1) << 31;
+const int DISTANCE_SHIFT = 16;
+
+uint64_t SplitMix( uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// FNV-1a по значениям клеток, независимый от хеша Зобриста.
+uint32_t CellHash( const Position& position, uint32_t hash) {
+    for ( int cell = 0; cell < position.Height() * position.Width(); ++cell ) {
+        hash = (hash ^ uint32_t( position.GetField( cell))) * 16777619u;
+    }
+    return hash;
+}
+
+uint64_t Pack( uint32_t check, int distance, const Position::Move& move) {
+    return (uint64_t( check) << 32) | (uint64_t( distance) << DISTANCE_SHIFT) | (uint64_t( move.from) << 8) | uint64_t( move.to);
+}
+
+} // namespace
+
+SolutionCache::SolutionCache()
+    : mapping_( 0), mapping_size_( 0), file_( -1), entries_( 0), mask_( 0) {
+}
+
+SolutionCache::~SolutionCache() {
+    Close();
+}
+
+void SolutionCache::Close() {
+    if ( mapping_ ) {
+        munmap( mapping_, mapping_size_);
+        mapping_ = 0;
+        mapping_size_ = 0;
+    }
+    if ( file_ >= 0 ) {
+        close( file_);
+        file_ = -1;
+    }
+    entries_ = 0;
+    mask_ = 0;
+    return;
+}
+
+bool SolutionCache::Open( const std::string& file_name, size_t bytes, std::string& error_msg) {
+    error_msg = "";
+    Close();
+    file_ = open( file_name.c_str(), O_RDWR | O_CREAT, 0644);
+    if ( file_ < 0 ) {
+        error_msg = "Can't open " + file_name;
+        return false;
+    }
+    // Новый файл создает первый открывший его процесс.
+    flock( file_, LOCK_EX);
+    struct stat info;
+    bool ok = (fstat( file_, &info) == 0);
+    if ( ok && !info.st_size ) {
+        uint64_t capacity = WINDOW;
+        while ( HEADER_SIZE + 2 * capacity * sizeof( Entry) <= bytes ) {
+            capacity *= 2;
+        }
+        unsigned char header[HEADER_SIZE] = {0};
+        uint32_t entry_size = sizeof( Entry);
+        std::memcpy( header, MAGIC, sizeof( MAGIC));
+        std::memcpy( header + 8, &VERSION, sizeof( VERSION));
+        std::memcpy( header + 12, &entry_size, sizeof( entry_size));
+        std::memcpy( header + 16, &capacity, sizeof( capacity));
+        ok = (ftruncate( file_, off_t( HEADER_SIZE + capacity * sizeof( Entry))) == 0)
+            && (pwrite( file_, header, sizeof( header), 0) == ssize_t( sizeof( header)))
+            && (fstat( file_, &info) == 0);
+    }
+    flock( file_, LOCK_UN);
+    if ( ok ) {
+        mapping_size_ = size_t( info.st_size);
+        mapping_ = mmap( 0, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0);
+        if ( mapping_ == MAP_FAILED ) {
+            mapping_ = 0;
+            Close();
+            error_msg = "Can't map " + file_name;
+            return false;
+        }
+    }
+    const unsigned char* header = static_cast<const unsigned char*>( mapping_);
+    uint32_t version = 0, entry_size = 0;
+    uint64_t capacity = 0;
+    if ( ok && (mapping_size_ >= HEADER_SIZE) ) {
+        std::memcpy( &version, header + 8, sizeof( version));
+        std::memcpy( &entry_size, header + 12, sizeof( entry_size));
+        std::memcpy( &capacity, header + 16, sizeof( capacity));
+    }
+    ok = ok && (mapping_size_ >= HEADER_SIZE) && !std::memcmp( header, MAGIC, sizeof( MAGIC)) && (version == VERSION)
+        && (entry_size == sizeof( Entry)) && (capacity >= WINDOW) && !(capacity & (capacity - 1))
+        && (HEADER_SIZE + capacity * sizeof( Entry) == mapping_size_);
+    if ( !ok ) {
+        Close();
+        error_msg = "Bad solution cache " + file_name;
+        return false;
+    }
+    entries_ = reinterpret_cast<Entry*>( static_cast<unsigned char*>( mapping_) + HEADER_SIZE);
+    mask_ = capacity - 1;
+    return true;
+}
+
+SolutionCache::Target SolutionCache::MakeTarget( const Position& goal) {
+    Target target;
+    target.hash = SplitMix( goal.Hash());
+    target.check = CellHash( goal, 2166136261u);
+    return target;
+}
+
+uint64_t SolutionCache::Key( const Target& target, const Position& position) {
+    uint64_t key = SplitMix( position.Hash() ^ target.hash);
+    return key ? key : 1;
+}
+
+uint32_t SolutionCache::Check( const Target& target, const Position& position) {
+    return CellHash( position, target.check);
+}
+
+bool SolutionCache::Lookup( const Target& target, const Position& position, int& distance, Position::Move& move) const {
+    if ( !entries_ || (position.Height() * position.Width() > MAX_CELLS) ) {
+        return false;
+    }
+    uint64_t key = Key( target, position);
+    for ( uint64_t probe = 0; probe < WINDOW; ++probe ) {
+        Entry& entry = entries_[(key + probe) & mask_];
+        if ( __atomic_load_n( &entry.key, __ATOMIC_ACQUIRE) != key ) {
+            continue;
+        }
+        uint64_t data = __atomic_load_n( &entry.data, __ATOMIC_ACQUIRE);
+        // Запись могла смениться, пока читались данные.
+        if ( (__atomic_load_n( &entry.key, __ATOMIC_ACQUIRE) != key) || (uint32_t( data >> 32) != Check( target, position)) ) {
+            continue;
+        }
+        if ( !(data & USED_BIT) ) {
+            __atomic_fetch_or( &entry.data, USED_BIT, __ATOMIC_RELAXED);
+        }
+        distance = int( (data >> DISTANCE_SHIFT) & MAX_DISTANCE);
+        move = Position::Move( int( (data >> 8) & 0xFF), int( data & 0xFF));
+        return true;
+    }
+    return false;
+}
+
+bool SolutionCache::Lookup( const Position& goal, const Position& position, int& distance, Position::Move& move) const {
+    return Lookup( MakeTarget( goal), position, distance, move);
+}
+
+Solution SolutionCache::Path( const Position& source, const Position& goal) const {
+    Target target = MakeTarget( goal);
+    Solution solution( source);
+    Position position = source;
+    int distance, expected = -1;
+    Position::Move move;
+    while ( position != goal ) {
+        // Расстояние должно убывать на каждом ходе, иначе цепочка испорчена
+        // совпадением ключей.
+        if ( !Lookup( target, position, distance, move) || ((expected >= 0) && (distance != expected)) || (distance <= 0)
+             || (move.from >= position.Height() * position.Width()) || (move.to >= position.Height() * position.Width())
+             || (position.GetField( move.to) != Position::BLANK) || (position.GetField( move.from) <= Position::BLANK) ) {
+            return Solution();
+        }
+        solution.Append( move);
+        position.Swap( move.from, move.to);
+        expected = distance - 1;
+    }
+    if ( expected > 0 ) {
+        return Solution();
+    }
+    return solution;
+}
+
+void SolutionCache::Insert( uint64_t key, uint64_t data) {
+    Entry* victim = 0;
+    // Та же позиция или пустая ячейка окна.
+    for ( uint64_t probe = 0; !victim && (probe < WINDOW); ++probe ) {
+        Entry& entry = entries_[(key + probe) & mask_];
+        uint64_t current = __atomic_load_n( &entry.key, __ATOMIC_ACQUIRE);
+        if ( (current == key) || !current ) {
+            victim = &entry;
+        }
+    }
+    // Часы: первый проход снимает биты использования, второй обязательно
+    // находит запись без бита.
+    for ( uint64_t probe = 0; !victim && (probe < 2 * WINDOW); ++probe ) {
+        Entry& entry = entries_[(key + probe) & mask_];
+        if ( __atomic_load_n( &entry.data, __ATOMIC_ACQUIRE) & USED_BIT ) {
+            __atomic_fetch_and( &entry.data, ~USED_BIT, __ATOMIC_RELAXED);
+        } else {
+            victim = &entry;
+        }
+    }
+    __atomic_store_n( &victim->key, uint64_t( 0), __ATOMIC_RELEASE);
+    __atomic_store_n( &victim->data, data, __ATOMIC_RELEASE);
+    __atomic_store_n( &victim->key, key, __ATOMIC_RELEASE);
+    return;
+}
+
+void SolutionCache::Store( const Solution& solution) {
+    if ( !entries_ || solution.Empty() || !solution.Length() || (solution.Length() > MAX_DISTANCE)
+         || (solution.Source().Height() * solution.Source().Width() > MAX_CELLS) ) {
+        return;
+    }
+    Target target = MakeTarget( solution.At( solution.Length()));
+    std::lock_guard<std::mutex> lock( write_mutex_);
+    flock( file_, LOCK_EX);
+    for ( int step = 0; step < solution.Length(); ++step ) {
+        Position::Move move = solution.MoveAt( step);
+        const Position& position = solution.At( step);
+        Insert( Key( target, position), Pack( Check( target, position), solution.Length() - step, move));
+    }
+    flock( file_, LOCK_UN);
+    return;
+}
+
+CachedHeuristic::CachedHeuristic( const Heuristic& prototype, const SolutionCache& cache)
+    : prototype_( prototype.Clone()), cache_( &cache) {
+    target_.hash = 0;
+    target_.check = 0;
+}
+
+bool CachedHeuristic::Prepare( const Position& goal) {
+    target_ = SolutionCache::MakeTarget( goal);
+    heuristic_.reset( prototype_->Clone());
+    return heuristic_->Prepare( goal);
+}
+
+int CachedHeuristic::Distance( const Position& position) const {
+    int distance;
+    Position::Move move;
+    if ( cache_->Lookup( target_, position, distance, move) ) {
+        return distance;
+    }
+    return heuristic_->Distance( position);
+}
+
+int CachedHeuristic::UpdateDistance( const Position& position, int, int, int) const {
+    return Distance( position);
+}
+
+Heuristic* CachedHeuristic::Clone() const {
+    return new CachedHeuristic( *this);
+}
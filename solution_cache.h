@@ -0,0 +1,94 @@
+#pragma once
+#ifndef _SOLUTION_CACHE_H_
+#define _SOLUTION_CACHE_H_
+
+#include <stdint.h>
+#include <string>
+#include <memory>
+#include <mutex>
+#include "position.h"
+#include "heuristic.h"
+#include "solution.h"
+
+// Кэш кратчайших расстояний в файле, отображенном в память: для пары (цель,
+// позиция) хранятся точное число ходов до цели и следующий ход кратчайшего
+// пути. Store записывает все позиции решения, поэтому кэш отвечает и на
+// задачи, начинающиеся в середине уже решенных.
+// Таблица фиксированного размера с открытой адресацией: запись ищется в окне
+// из WINDOW соседних ячеек. При вставке в заполненное окно вытесняется
+// запись по алгоритму часов: обращение ставит записи бит использования,
+// вставка снимает его с записей окна и вытесняет первую без бита.
+// Записи идентифицируются 64-битным ключом и независимой 32-битной
+// проверкой. Чтение не блокируется и безопасно одновременно с записью из
+// других потоков и процессов: запись обнуляет ключ, меняет данные и
+// восстанавливает ключ, а читатель проверяет ключ до и после чтения данных.
+// Писатели упорядочиваются мьютексом и flock на файле.
+class SolutionCache {
+public:
+    SolutionCache();
+    ~SolutionCache();
+    // Открывает файл или создает новый размером не больше bytes байт (число
+    // ячеек - степень двойки); размер существующего файла сохраняется.
+    bool Open( const std::string& file_name, size_t bytes, std::string& error_msg);
+    bool IsOpen() const {return entries_ != 0;}
+    // Число ячеек.
+    uint64_t Capacity() const {return mask_ + 1;}
+    // Расстояние от position до goal и ход фишки из move.from в move.to
+    // (пустое место) по кратчайшему пути; false, если записи нет.
+    bool Lookup( const Position& goal, const Position& position, int& distance, Position::Move& move) const;
+    // Кратчайший путь по цепочке записей; пустое решение, если она обрывается.
+    Solution Path( const Position& source, const Position& goal) const;
+    // Запоминает позиции кратчайшего пути solution, цель - его последняя позиция.
+    // Поля больше MAX_CELLS клеток и пути длиннее MAX_DISTANCE не кэшируются.
+    void Store( const Solution& solution);
+    const static uint32_t VERSION;
+    enum { MAX_CELLS = 256, MAX_DISTANCE = (1 << 15) - 1, WINDOW = 8 };
+private:
+    SolutionCache( const SolutionCache&);
+    SolutionCache& operator=( const SolutionCache&);
+    // Ячейка: ключ (0 - пусто) и упакованные данные: проверка в старших 32
+    // битах, затем бит использования, 15 бит расстояния, клетки хода по 8 бит.
+    struct Entry {
+        uint64_t key;
+        uint64_t data;
+    };
+    // Хеш цели, общий для всех позиций к ней.
+    struct Target {
+        uint64_t hash;
+        uint32_t check;
+    };
+    static Target MakeTarget( const Position& goal);
+    static uint64_t Key( const Target& target, const Position& position);
+    static uint32_t Check( const Target& target, const Position& position);
+    bool Lookup( const Target& target, const Position& position, int& distance, Position::Move& move) const;
+    void Insert( uint64_t key, uint64_t data);
+    void Close();
+    void* mapping_;
+    size_t mapping_size_;
+    int file_;
+    Entry* entries_;
+    uint64_t mask_;
+    std::mutex write_mutex_;
+    friend class CachedHeuristic;
+};
+
+// Оценка, уточненная кэшем: точное расстояние из кэша, если позиция в нем
+// есть, иначе оценка prototype. Оценка допустима, но не монотонна, поэтому
+// подходит поискам, которым монотонность не нужна (IDA*, MM).
+// UpdateDistance пересчитывает оценку заново.
+class CachedHeuristic : public Heuristic {
+public:
+    // Хранит копию prototype; cache должен жить, пока используются копии.
+    CachedHeuristic( const Heuristic& prototype, const SolutionCache& cache);
+    virtual bool Prepare( const Position& goal);
+    virtual int Distance( const Position& position) const;
+    virtual int UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const;
+    virtual Heuristic* Clone() const;
+private:
+    std::shared_ptr<const Heuristic> prototype_;
+    std::shared_ptr<Heuristic> heuristic_;
+    const SolutionCache* cache_;
+    SolutionCache::Target target_;
+};
+
+#endif /* _SOLUTION_CACHE_H_ */
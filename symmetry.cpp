@@ -0,0 +1,125 @@
+#include "symmetry.h"
+#include <algorithm>
+#include <stdexcept>
+
+SymmetryGroup::SymmetryGroup()
+    : height_( 0), width_( 0) {
+}
+
+bool SymmetryGroup::Detect( const Position& goal) {
+    height_ = goal.Height();
+    width_ = goal.Width();
+    int cells = height_ * width_;
+    int max_value = 0;
+    for ( int index = 0; index < cells; ++index ) {
+        max_value = std::max( max_value, goal.GetField( index));
+    }
+    transforms_.clear();
+    // Отражения и повороты: клетка (row, column) переходит в (row', column').
+    int kinds = (height_ == width_) ? 8 : 4;
+    for ( int kind = 0; kind < kinds; ++kind ) {
+        Transform transform;
+        transform.cells.resize( cells);
+        for ( int row = 0; row < height_; ++row ) {
+            for ( int column = 0; column < width_; ++column ) {
+                int mirrored_row = (kind & 1) ? height_ - 1 - row : row;
+                int mirrored_column = (kind & 2) ? width_ - 1 - column : column;
+                int image = (kind & 4) ? mirrored_column * width_ + mirrored_row : mirrored_row * width_ + mirrored_column;
+                transform.cells[row * width_ + column] = image;
+            }
+        }
+        // Камни должны переходить в камни, пустые места - в пустые места, а
+        // все фишки одного значения - в фишки одного значения, причем разные
+        // значения - в разные.
+        transform.values.assign( max_value + 1, -1);
+        std::vector<int> sources( max_value + 1, -1);
+        bool symmetric = true;
+        for ( int index = 0; symmetric && (index < cells); ++index ) {
+            int value = goal.GetField( index);
+            int image = goal.GetField( transform.cells[index]);
+            if ( (value <= Position::BLANK) || (image <= Position::BLANK) ) {
+                symmetric = (value == image);
+            } else if ( (transform.values[value] == -1) && (sources[image] == -1) ) {
+                transform.values[value] = image;
+                sources[image] = value;
+            } else {
+                symmetric = (transform.values[value] == image);
+            }
+        }
+        if ( symmetric ) {
+            transforms_.push_back( transform);
+        }
+    }
+    buffer_.resize( cells);
+    return transforms_.size() > 1;
+}
+
+Position SymmetryGroup::Apply( int index, const Position& position) const {
+    const Transform& transform = transforms_[index];
+    for ( int cell = 0; cell < height_ * width_; ++cell ) {
+        int value = position.GetField( cell);
+        buffer_[transform.cells[cell]] = (value > Position::BLANK) ? transform.values[value] : value;
+    }
+    return Position( height_, width_, buffer_);
+}
+
+Position SymmetryGroup::Canonical( const Position& position) const {
+    Position best = position;
+    for ( int index = 1; index < Size(); ++index ) {
+        Position image = Apply( index, position);
+        if ( image < best ) {
+            best = image;
+        }
+    }
+    return best;
+}
+
+std::vector<Position> SymmetryGroup::Unfold( const Position& source, const std::vector<Position>& way) const {
+    std::vector<Position> result;
+    if ( way.empty() ) {
+        return result;
+    }
+    result.push_back( source);
+    std::vector<Position::Move> moves;
+    for ( size_t step = 1; step < way.size(); ++step ) {
+        Position target = Canonical( way[step]);
+        const Position& current = result.back();
+        current.GetPossibleMoves( moves);
+        size_t index = 0;
+        while ( (index < moves.size())
+                && (Canonical( current.GetSwaped( moves[index].from, moves[index].to)) != target) ) {
+            ++index;
+        }
+        if ( index == moves.size() ) {
+            throw std::logic_error( "Way is not a path of symmetry classes");
+        }
+        result.push_back( current.GetSwaped( moves[index].from, moves[index].to));
+    }
+    return result;
+}
+
+SymmetricHeuristic::SymmetricHeuristic( const Heuristic& prototype)
+    : prototype_( prototype.Clone()) {
+}
+
+bool SymmetricHeuristic::Prepare( const Position& goal) {
+    group_.Detect( goal);
+    heuristic_.reset( prototype_->Clone());
+    return heuristic_->Prepare( goal);
+}
+
+int SymmetricHeuristic::Distance( const Position& position) const {
+    int distance = heuristic_->Distance( position);
+    for ( int index = 1; index < group_.Size(); ++index ) {
+        distance = std::max( distance, heuristic_->Distance( group_.Apply( index, position)));
+    }
+    return distance;
+}
+
+int SymmetricHeuristic::UpdateDistance( const Position& position, int, int, int) const {
+    return Distance( position);
+}
+
+Heuristic* SymmetricHeuristic::Clone() const {
+    return new SymmetricHeuristic( *this);
+}
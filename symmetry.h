@@ -0,0 +1,68 @@
+#pragma once
+#ifndef _SYMMETRY_H_
+#define _SYMMETRY_H_
+
+#include <vector>
+#include <memory>
+#include "position.h"
+#include "heuristic.h"
+
+// Симметрии цели: отражения и повороты поля (для квадратного поля - и
+// отражения относительно диагоналей), которые вместе с перенумерацией фишек
+// переводят цель в себя, а камни - в камни. Такое преобразование переводит
+// ходы в ходы, поэтому все позиции одной орбиты одинаково далеки от цели, и
+// поиск к этой цели может хранить одного представителя орбиты - наименьшую
+// из ее позиций. Путь по представителям переводится обратно в ходы по
+// исходному полю через Unfold. Apply и Canonical пользуются внутренним
+// буфером, поэтому объект нельзя использовать из нескольких потоков сразу.
+class SymmetryGroup {
+public:
+    SymmetryGroup();
+    // Находит симметрии goal. false, если есть только тождественная.
+    bool Detect( const Position& goal);
+    // Число преобразований, включая тождественное (нулевое).
+    int Size() const {return int( transforms_.size());}
+    // Образ position при преобразовании index.
+    Position Apply( int index, const Position& position) const;
+    // Представитель орбиты position.
+    Position Canonical( const Position& position) const;
+    // Путь из source, проходящий через орбиты позиций way по порядку; way[0]
+    // - в орбите source, соседние позиции way - в соседних орбитах (например,
+    // путь по представителям). Так как орбита цели состоит из самой цели,
+    // путь к цели переводится в путь к ней же. Если из очередной позиции нет
+    // хода в орбиту следующей позиции way, бросает std::logic_error.
+    std::vector<Position> Unfold( const Position& source, const std::vector<Position>& way) const;
+private:
+    struct Transform {
+        // Клетка образа для каждой клетки.
+        std::vector<int> cells;
+        // Значение фишки образа для каждого значения фишки.
+        std::vector<int> values;
+    };
+    int height_;
+    int width_;
+    std::vector<Transform> transforms_;
+    // Клетки строящегося образа.
+    mutable std::vector<int> buffer_;
+};
+
+// Наибольшая из оценок образов позиции при симметриях цели. Для базы
+// шаблонов это дополнительные просмотры по отраженным шаблонам, то есть
+// более точная оценка без новой базы. Результат одинаков для всей орбиты,
+// что нужно поиску по представителям, если исходная оценка этим свойством
+// не обладает. UpdateDistance пересчитывает оценку заново.
+class SymmetricHeuristic : public Heuristic {
+public:
+    // Хранит копию prototype.
+    explicit SymmetricHeuristic( const Heuristic& prototype);
+    virtual bool Prepare( const Position& goal);
+    virtual int Distance( const Position& position) const;
+    virtual int UpdateDistance( const Position& position, int old_distance, int move_from, int move_to) const;
+    virtual Heuristic* Clone() const;
+private:
+    std::shared_ptr<const Heuristic> prototype_;
+    std::shared_ptr<Heuristic> heuristic_;
+    SymmetryGroup group_;
+};
+
+#endif /* _SYMMETRY_H_ */
@@ -0,0 +1,87 @@
+#include "position.h"
+#include "distance_table.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Строит таблицу точных расстояний для стандартной цели height x width
+// (фишки по порядку, пустое место в последней клетке без камня) и
+// записывает ее в файл. Камни задаются номерами клеток через ',',
+// например 5,6. Поиск в ширину держит в памяти только буфер фронта
+// размером --memory-mb, остальное - на диске рядом с файлом таблицы.
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    std::cerr << "Usage: " << argv[0]
+              << " <file> <height> <width> [stones] [--memory-mb n]"
+              << std::endl;
+    return 1;
+  }
+  int height = atoi(argv[2]), width = atoi(argv[3]);
+  if (height <= 0 || width <= 0) {
+    std::cerr << "Bad board size" << std::endl;
+    return 1;
+  }
+  std::vector<int> cells(height * width, 0);
+  size_t memory = 256u << 20;
+  for (int i = 4; i < argc; ++i) {
+    if (strcmp(argv[i], "--memory-mb") == 0 && i + 1 < argc) {
+      memory = size_t(atof(argv[++i]) * 1024 * 1024);
+      continue;
+    }
+    std::stringstream stones(argv[i]);
+    std::string stone;
+    while (std::getline(stones, stone, ',')) {
+      int cell = atoi(stone.c_str());
+      if (cell < 0 || cell >= height * width) {
+        std::cerr << "Bad stone cell " << stone << std::endl;
+        return 1;
+      }
+      cells[cell] = Position::STONE;
+    }
+  }
+  int next = 1;
+  int last = -1;
+  for (int cell = 0; cell < height * width; ++cell) {
+    if (cells[cell] != Position::STONE) {
+      cells[cell] = next++;
+      last = cell;
+    }
+  }
+  if (last < 0) {
+    std::cerr << "No free cells" << std::endl;
+    return 1;
+  }
+  cells[last] = Position::BLANK;
+  Position goal(height, width, cells);
+
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  DistanceTable table;
+  std::string msg;
+  bool ok;
+  try {
+    ok = table.Build(goal, argv[1], memory, msg,
+                     [](int depth, uint64_t count) {
+                       std::cerr << "depth " << depth << ": " << count
+                                 << std::endl;
+                     });
+  } catch (const std::exception& e) {
+    std::cerr << "Can't build distance table (at most "
+              << DistanceTable::MAX_FREE_CELLS << " free cells): " << e.what()
+              << std::endl;
+    return 1;
+  }
+  if (!ok) {
+    std::cerr << msg << std::endl;
+    return 1;
+  }
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start).count();
+  std::cerr << table.States() << " states, max depth " << table.MaxDepth()
+            << ", " << seconds << " s" << std::endl;
+  return 0;
+}
@@ -0,0 +1,115 @@
+#include "thread_pool.h"
+#include <stdexcept>
+
+namespace {
+
+thread_local const ThreadPool* current_pool = 0;
+thread_local int current_worker = -1;
+
+} // namespace
+
+ThreadPool::ThreadPool( int threads)
+    : queued_( 0), pending_( 0), next_queue_( 0), stop_( false) {
+    if ( threads <= 0 ) {
+        throw std::invalid_argument( "threads");
+    }
+    for ( int worker = 0; worker < threads; ++worker ) {
+        queues_.push_back( std::unique_ptr<Queue>( new Queue()));
+    }
+    for ( int worker = 0; worker < threads; ++worker ) {
+        threads_.push_back( std::thread( &ThreadPool::Run, this, worker));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock( mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for ( size_t worker = 0; worker < threads_.size(); ++worker ) {
+        threads_[worker].join();
+    }
+}
+
+int ThreadPool::CurrentWorker() const {
+    return (current_pool == this) ? current_worker : -1;
+}
+
+void ThreadPool::Submit( const Task& task) {
+    int worker = CurrentWorker();
+    {
+        std::lock_guard<std::mutex> lock( mutex_);
+        if ( worker < 0 ) {
+            worker = int( next_queue_++ % queues_.size());
+        }
+        ++pending_;
+    }
+    {
+        std::lock_guard<std::mutex> lock( queues_[worker]->mutex);
+        queues_[worker]->tasks.push_back( task);
+    }
+    {
+        std::lock_guard<std::mutex> lock( mutex_);
+        ++queued_;
+    }
+    wake_.notify_one();
+    return;
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock( mutex_);
+    while ( pending_ ) {
+        done_.wait( lock);
+    }
+    return;
+}
+
+// Вызывается, когда за потоком уже зарезервирована одна из задач в очередях.
+ThreadPool::Task ThreadPool::Take( int worker) {
+    for ( ;; ) {
+        {
+            Queue& own = *queues_[worker];
+            std::lock_guard<std::mutex> lock( own.mutex);
+            if ( !own.tasks.empty() ) {
+                Task task = own.tasks.back();
+                own.tasks.pop_back();
+                return task;
+            }
+        }
+        for ( size_t shift = 1; shift < queues_.size(); ++shift ) {
+            Queue& other = *queues_[(worker + shift) % queues_.size()];
+            std::lock_guard<std::mutex> lock( other.mutex);
+            if ( !other.tasks.empty() ) {
+                Task task = other.tasks.front();
+                other.tasks.pop_front();
+                return task;
+            }
+        }
+        std::this_thread::yield();
+    }
+}
+
+void ThreadPool::Run( int worker) {
+    current_pool = this;
+    current_worker = worker;
+    for ( ;; ) {
+        {
+            std::unique_lock<std::mutex> lock( mutex_);
+            while ( !queued_ && !stop_ ) {
+                wake_.wait( lock);
+            }
+            if ( !queued_ ) {
+                return;
+            }
+            --queued_;
+        }
+        Task task = Take( worker);
+        task( worker);
+        std::lock_guard<std::mutex> lock( mutex_);
+        if ( !--pending_ ) {
+            done_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Пул потоков с собственной очередью задач у каждого потока. Поток берет
+// задачи с конца своей очереди, а когда она пуста - крадет с начала чужих.
+class ThreadPool {
+public:
+    // Задача получает номер выполняющего ее потока.
+    typedef std::function<void( int worker)> Task;
+    explicit ThreadPool( int threads);
+    // Дожидается выполнения всех задач и останавливает потоки.
+    ~ThreadPool();
+    int Size() const {return int( threads_.size());}
+    // Из потока пула задача попадает в его очередь, иначе - в очереди по кругу.
+    void Submit( const Task& task);
+    // Ждет, пока не будут выполнены все поставленные задачи.
+    void Wait();
+    // Номер текущего потока в пуле или -1 для посторонних потоков.
+    int CurrentWorker() const;
+private:
+    ThreadPool( const ThreadPool&);
+    ThreadPool& operator=( const ThreadPool&);
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    void Run( int worker);
+    Task Take( int worker);
+    std::vector< std::unique_ptr<Queue> > queues_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    // Задачи в очередях и задачи, еще не завершенные.
+    size_t queued_;
+    size_t pending_;
+    size_t next_queue_;
+    bool stop_;
+};
+
+#endif /* _THREAD_POOL_H_ */